@@ -0,0 +1,68 @@
+// Medición: expansión de aliases en un script con muchos aliases encadenados.
+// Compara la versión anterior (map<string,string>, tokenize en cada uso, un solo nivel, con mutex
+// para que sea correcta con varios hilos) con resolve_alias (pre-tokenizado, instantánea sin bloqueo).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 bench/bench_alias.cpp $(ls src/*.cpp | grep -v main.cpp) -Iinclude -o bench_alias -pthread
+#include "builtins.hpp"
+#include "parser.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+
+static std::map<std::string, std::string> legacy_aliases;
+static std::mutex legacy_mutex;
+
+// Implementación anterior, con el mutex que le faltaba
+static bool legacy_resolve(std::vector<std::string> &tokens) {
+    std::lock_guard<std::mutex> lk(legacy_mutex);
+    auto it = legacy_aliases.find(tokens[0]);
+    if (it == legacy_aliases.end()) return false;
+    std::vector<std::string> ali_tok = tokenize(it->second);
+    std::vector<std::string> newt;
+    newt.insert(newt.end(), ali_tok.begin(), ali_tok.end());
+    newt.insert(newt.end(), tokens.begin()+1, tokens.end());
+    tokens.swap(newt);
+    return true;
+}
+
+template <class F>
+static double ops_per_sec(F resolve, int threads, size_t per_thread) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t=0;t<threads;++t) {
+        pool.emplace_back([&, t] {
+            for (size_t i=0;i<per_thread;++i) {
+                std::vector<std::string> tokens = { "a" + std::to_string((i + t) % 64), "arg1", "arg2" };
+                resolve(tokens);
+            }
+        });
+    }
+    for (auto &th: pool) th.join();
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return threads * per_thread / s;
+}
+
+int main(int argc, char **argv) {
+    size_t per_thread = (argc > 1 ? std::stoul(argv[1]) : 200000);
+    // 64 aliases; cada uno apunta al anterior, así que la expansión completa tiene varios niveles
+    for (int i=0;i<64;++i) {
+        std::string name = "a" + std::to_string(i);
+        std::string value = (i % 4 == 0 ? std::string("ls -l --color=never") : "a" + std::to_string(i-1) + " -h");
+        define_alias(name, value);
+        legacy_aliases[name] = value;
+    }
+    std::cout << "hilos  anterior_ops/s  resolve_alias_ops/s\n";
+    for (int threads : {1, 4}) {
+        double legacy = ops_per_sec(legacy_resolve, threads, per_thread);
+        double current = ops_per_sec([](std::vector<std::string> &t) { return resolve_alias(t); }, threads, per_thread);
+        std::cout << std::setw(5) << threads << std::fixed << std::setprecision(0)
+                  << std::setw(16) << legacy << std::setw(21) << current << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,295 @@
+// Carga de extremo a extremo: lanza mini_shell en un pseudo-terminal (modo interactivo, con prompt
+// e historial) y le envía miles de comandos mezclados: tuberías, redirecciones (también con varias
+// salidas), trabajos en segundo plano, parallel, pmap, $(...), listas con ; && ||, alias, errores y Ctrl+C sobre un
+// comando en primer plano. La latencia de cada comando va de escribir la línea a ver el siguiente
+// prompt.
+//
+// Tras cada lote se drenan los trabajos ('wait') y se mide la shell desde /proc: descriptores
+// abiertos, hilos, hijos zombies y RSS. Termina con estado 1 si hay zombies, si los descriptores
+// o los hilos superan a los del primer lote o si el RSS crece más que el margen.
+//
+// Uso:
+//   bench_pty ./mini_shell [--commands N] [--batch N] [--rss-slack KiB] [--json archivo]
+// Con CMake: 'cmake --build build --target leakcheck'.
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <signal.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+
+static const std::string PROMPT = "mini-shell$ ";
+
+static double now_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Rango más cercano, como 'stats' (accounting.cpp)
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t rank = (size_t)std::ceil(p * v.size());
+    return v[rank > 0 ? std::min(rank, v.size()) - 1 : 0];
+}
+
+// La shell bajo prueba, con el extremo maestro del pty
+struct Shell {
+    pid_t pid = -1;
+    int master = -1;
+    std::string pending; // Salida leída y aún no consumida
+
+    bool start(const std::string &path, const std::string &histfile) {
+        master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) { perror("posix_openpt"); return false; }
+        std::string slave = ptsname(master);
+        pid = fork();
+        if (pid < 0) { perror("fork"); return false; }
+        if (pid == 0) {
+            setsid();
+            int s = open(slave.c_str(), O_RDWR);
+            if (s < 0) { perror(slave.c_str()); _exit(127); }
+            ioctl(s, TIOCSCTTY, 0);
+            // Sin eco: la salida es solo lo que escribe la shell. ICANON e ISIG siguen activos,
+            // así que getline recibe líneas y \x03 genera SIGINT al grupo en primer plano.
+            struct termios t;
+            tcgetattr(s, &t);
+            t.c_lflag &= ~(ECHO | ECHOE | ECHOK | ECHONL);
+            tcsetattr(s, TCSANOW, &t);
+            dup2(s, STDIN_FILENO); dup2(s, STDOUT_FILENO); dup2(s, STDERR_FILENO);
+            if (s > STDERR_FILENO) close(s);
+            setenv("MINISHELL_HISTFILE", histfile.c_str(), 1);
+            execl(path.c_str(), path.c_str(), (char*)nullptr);
+            perror(path.c_str());
+            _exit(127);
+        }
+        return wait_prompt(10000) >= 0;
+    }
+
+    void send(const std::string &text) {
+        size_t off = 0;
+        while (off < text.size()) {
+            ssize_t w = write(master, text.data() + off, text.size() - off);
+            if (w < 0) { if (errno == EINTR) continue; perror("write pty"); return; }
+            off += (size_t)w;
+        }
+    }
+
+    // Lee hasta que la salida termina en el prompt; devuelve los ms esperados (-1 si vence el plazo)
+    double wait_prompt(double timeout_ms) {
+        double t0 = now_ms();
+        char buf[65536];
+        while (true) {
+            if (pending.size() >= PROMPT.size() &&
+                pending.compare(pending.size() - PROMPT.size(), PROMPT.size(), PROMPT) == 0) {
+                pending.clear();
+                return now_ms() - t0;
+            }
+            double left = timeout_ms - (now_ms() - t0);
+            if (left <= 0) return -1;
+            struct pollfd p = { master, POLLIN, 0 };
+            int r = poll(&p, 1, (int)left + 1);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) continue;
+            ssize_t n = read(master, buf, sizeof(buf));
+            if (n <= 0) return -1; // La shell terminó (EIO en el maestro)
+            pending.append(buf, (size_t)n);
+            if (pending.size() > (1 << 20)) pending.erase(0, pending.size() - PROMPT.size());
+        }
+    }
+};
+
+// Estado de la shell leído de /proc
+struct Sample {
+    int fds = 0, threads = 0, zombies = 0;
+    long rss_kb = 0;
+};
+
+static Sample sample(pid_t pid) {
+    Sample s;
+    std::string base = "/proc/" + std::to_string(pid);
+    if (DIR *d = opendir((base + "/fd").c_str())) {
+        while (struct dirent *e = readdir(d)) if (e->d_name[0] != '.') ++s.fds;
+        closedir(d);
+    }
+    std::ifstream st(base + "/status");
+    std::string line;
+    while (std::getline(st, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0) s.rss_kb = atol(line.c_str() + 6);
+        else if (line.compare(0, 8, "Threads:") == 0) s.threads = atoi(line.c_str() + 8);
+    }
+    // Hijos zombies: procesos con ppid == pid en estado Z
+    if (DIR *d = opendir("/proc")) {
+        while (struct dirent *e = readdir(d)) {
+            if (e->d_name[0] < '0' || e->d_name[0] > '9') continue;
+            std::ifstream f(std::string("/proc/") + e->d_name + "/stat");
+            std::string stat;
+            if (!std::getline(f, stat)) continue;
+            size_t rp = stat.rfind(')'); // El nombre puede contener espacios
+            if (rp == std::string::npos) continue;
+            char state; int ppid;
+            if (sscanf(stat.c_str() + rp + 1, " %c %d", &state, &ppid) == 2 && ppid == pid && state == 'Z') ++s.zombies;
+        }
+        closedir(d);
+    }
+    return s;
+}
+
+struct Kind {
+    std::string name;
+    std::vector<std::string> lines; // Se usan por turnos
+    bool interrupt = false;         // Envía Ctrl+C mientras corre
+};
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "uso: " << argv[0] << " mini_shell [--commands N] [--batch N] [--rss-slack KiB] [--json archivo]\n";
+        return 2;
+    }
+    std::string shell_path = argv[1], json_path;
+    long commands = 20000, batch = 1000, rss_slack = 1024;
+    for (int i=2;i<argc;++i) {
+        std::string a = argv[i];
+        if (a == "--commands" && i + 1 < argc) commands = atol(argv[++i]);
+        else if (a == "--batch" && i + 1 < argc) batch = std::max(1L, atol(argv[++i]));
+        else if (a == "--rss-slack" && i + 1 < argc) rss_slack = atol(argv[++i]);
+        else if (a == "--json" && i + 1 < argc) json_path = argv[++i];
+        else { std::cerr << "opción desconocida: " << a << "\n"; return 2; }
+    }
+
+    char dir_tmpl[] = "/tmp/mini_shell_pty.XXXXXX";
+    if (!mkdtemp(dir_tmpl)) { perror("mkdtemp"); return 1; }
+    std::string dir = dir_tmpl;
+
+    // Mezcla de comandos (se elige por peso); D se sustituye por el directorio temporal
+    std::vector<std::pair<int, Kind>> mix = {
+        {20, {"simple", {"true", "echo hola", "pwd", "ls -d D", "nonexistent_cmd_xyz"}}},
+        {20, {"pipe", {"echo hola | wc -c", "ls D | sort | wc -l", "cat D/a.txt | tr a-z A-Z | head -1"}}},
+        {15, {"redir", {"echo x > D/a.txt", "cat < D/a.txt >> D/b.txt", "wc -c < D/a.txt > D/c.txt",
+                        "echo y > D/t1 >> D/t2 | wc -c", "pwd > D/p.txt"}}},
+        {10, {"background", {"true &", "sleep 0.01 &", "echo bg > D/bg.txt &"}}},
+        {8, {"parallel", {"parallel true ;; false ;; echo p", "parallel -j 2 true ;; true ;; true"}}},
+        {5, {"pmap", {"ls D | pmap -j 2 echo {}"}}},
+        {8, {"subst", {"echo $(echo sub) \"$(pwd)\"", "echo $(cat D/a.txt | wc -c)"}}},
+        {6, {"list", {"true && echo a || echo b ; false || echo $?", "cd D && pwd ; cd / ; false ; echo $?"}}},
+        {6, {"alias_builtin", {"ll -d D", "history -n 3", "hash", "jobs"}}},
+        {3, {"ctrl_c", {"sleep 5", "sleep 5 | cat", "parallel sleep 5 ;; sleep 5", "sleep 5 > D/s1 > D/s2", "sleep 5 ; sleep 5"}, true}},
+    };
+    for (auto &m: mix)
+        for (auto &l: m.second.lines)
+            for (size_t p; (p = l.find(" D")) != std::string::npos; ) l.replace(p + 1, 1, dir);
+    int total_weight = 0;
+    for (auto &m: mix) total_weight += m.first;
+
+    Shell sh;
+    if (!sh.start(shell_path, dir + "/history")) { std::cerr << "no se pudo arrancar " << shell_path << "\n"; return 1; }
+    sh.send("alias ll='ls -l'\n");
+    sh.wait_prompt(10000);
+
+    std::map<std::string, std::vector<double>> lat;
+    std::vector<double> all;
+    std::map<std::string, size_t> turn;
+    Sample first;
+    long rss_max = 0;
+    bool failed = false;
+    unsigned rnd = 12345;
+    std::cout << "lote  comandos   p50_ms   p99_ms  fds  hilos  zombies  rss_kb\n";
+    long done = 0;
+    for (int b=1; done < commands; ++b) {
+        std::vector<double> batch_lat;
+        for (long i=0; i<batch && done < commands; ++i, ++done) {
+            rnd = rnd * 1103515245 + 12345;
+            int w = (int)((rnd >> 8) % total_weight);
+            size_t k = 0;
+            while (w >= mix[k].first) w -= mix[k++].first;
+            Kind &kind = mix[k].second;
+            const std::string &line = kind.lines[turn[kind.name]++ % kind.lines.size()];
+            double t0 = now_ms();
+            sh.send(line + "\n");
+            if (kind.interrupt) {
+                usleep(20000); // Que el comando llegue a lanzarse
+                sh.send("\x03");
+            }
+            double waited = sh.wait_prompt(10000);
+            if (waited < 0) {
+                std::cerr << "sin prompt tras '" << line << "' (lote " << b << ")\n";
+                failed = true;
+                break;
+            }
+            double ms = now_ms() - t0;
+            lat[kind.name].push_back(ms);
+            batch_lat.push_back(ms);
+            all.push_back(ms);
+        }
+        if (failed) break;
+        // Drena los trabajos en segundo plano; el siguiente prompt ya ha notificado los terminados
+        sh.send("wait\n");
+        sh.wait_prompt(10000);
+        sh.send("true\n");
+        sh.wait_prompt(10000);
+        Sample s = sample(sh.pid);
+        if (b == 1) first = s;
+        rss_max = std::max(rss_max, s.rss_kb);
+        std::cout << std::setw(4) << b << std::setw(10) << done << std::fixed << std::setprecision(2)
+                  << std::setw(9) << percentile(batch_lat, 0.5) << std::setw(9) << percentile(batch_lat, 0.99)
+                  << std::setw(5) << s.fds << std::setw(7) << s.threads << std::setw(9) << s.zombies
+                  << std::setw(8) << s.rss_kb << std::endl;
+        if (s.zombies > 0) { std::cerr << "FALLO: " << s.zombies << " zombies tras el lote " << b << "\n"; failed = true; }
+        if (s.fds > first.fds) { std::cerr << "FALLO: descriptores " << first.fds << " -> " << s.fds << "\n"; failed = true; }
+        if (s.threads > first.threads) { std::cerr << "FALLO: hilos " << first.threads << " -> " << s.threads << "\n"; failed = true; }
+        if (s.rss_kb > first.rss_kb + rss_slack) {
+            std::cerr << "FALLO: RSS " << first.rss_kb << " -> " << s.rss_kb << " KiB (margen " << rss_slack << ")\n";
+            failed = true;
+        }
+        if (failed) break;
+    }
+
+    sh.send("salir\n");
+    int status;
+    for (int i=0; i<100 && waitpid(sh.pid, &status, WNOHANG) == 0; ++i) usleep(10000);
+    if (waitpid(sh.pid, &status, WNOHANG) == 0) { kill(sh.pid, SIGKILL); waitpid(sh.pid, &status, 0); }
+    close(sh.master);
+
+    std::cout << "\ntipo              n    p50_ms   p90_ms   p99_ms   max_ms\n";
+    auto row = [](const std::string &name, const std::vector<double> &v) {
+        std::cout << std::left << std::setw(14) << name << std::right << std::setw(7) << v.size() << std::fixed
+                  << std::setprecision(2) << std::setw(10) << percentile(v, 0.5) << std::setw(9) << percentile(v, 0.9)
+                  << std::setw(9) << percentile(v, 0.99) << std::setw(9) << percentile(v, 1.0) << "\n";
+    };
+    for (auto &p: lat) row(p.first, p.second);
+    row("total", all);
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        out << "{\n  \"suite\": \"mini_shell_pty\",\n  \"commands\": " << done << ",\n  \"passed\": "
+            << (failed ? "false" : "true") << ",\n  \"fds\": " << first.fds << ",\n  \"threads\": " << first.threads
+            << ",\n  \"rss_kb_first\": " << first.rss_kb << ",\n  \"rss_kb_max\": " << rss_max << ",\n  \"latency_ms\": {\n";
+        size_t i = 0;
+        lat["total"] = all;
+        for (auto &p: lat) {
+            out << "    \"" << p.first << "\": {\"n\": " << p.second.size() << ", \"p50\": " << percentile(p.second, 0.5)
+                << ", \"p90\": " << percentile(p.second, 0.9) << ", \"p99\": " << percentile(p.second, 0.99)
+                << ", \"max\": " << percentile(p.second, 1.0) << "}" << (++i < lat.size() ? ",\n" : "\n");
+        }
+        out << "  }\n}\n";
+    }
+
+    std::string rm = "rm -rf " + dir;
+    if (system(rm.c_str()) != 0) std::cerr << "no se pudo borrar " << dir << "\n";
+    std::cout << (failed ? "FALLO\n" : "OK\n");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+// Medición: latencia de lanzar /bin/true con fork()+execv frente a spawn_command (posix_spawn)
+// a medida que crece el heap de la shell. Con fork el coste crece con el RSS; con spawn se mantiene plano.
+//
+// Compilar:
+//   g++ -std=c++17 -O2 bench/bench_spawn.cpp $(ls src/*.cpp | grep -v main.cpp) -Iinclude -o bench_spawn -pthread
+#include "executor.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static double now_us() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+// fork()+execv clásico, como hacía el ejecutor antes
+static double bench_fork(int iters) {
+    char *argv[] = { const_cast<char*>("/bin/true"), nullptr };
+    double t0 = now_us();
+    for (int i=0;i<iters;++i) {
+        pid_t pid = fork();
+        if (pid == 0) { execv(argv[0], argv); _exit(127); }
+        int status; waitpid(pid, &status, 0);
+    }
+    return (now_us() - t0) / iters;
+}
+
+static double bench_spawn(int iters) {
+    std::vector<std::string> argv_tokens = { "/bin/true" };
+    Redirections none;
+    double t0 = now_us();
+    for (int i=0;i<iters;++i) wait_child(spawn_command(argv_tokens, none, -1, -1));
+    return (now_us() - t0) / iters;
+}
+
+int main(int argc, char **argv) {
+    int iters = (argc > 1 ? atoi(argv[1]) : 200);
+    std::vector<char*> heap; // Bloques de 64 MiB tocados para que cuenten en el RSS
+    const size_t block = 64u << 20;
+    std::cout << "heap_MiB   fork_us   spawn_us\n";
+    for (int mib : {0, 64, 256, 1024}) {
+        while (heap.size() * 64 < (size_t)mib) {
+            char *p = new char[block];
+            memset(p, 1, block);
+            heap.push_back(p);
+        }
+        std::cout << std::setw(8) << mib
+                  << std::setw(10) << std::fixed << std::setprecision(1) << bench_fork(iters)
+                  << std::setw(11) << bench_spawn(iters) << "\n";
+    }
+    for (char *p : heap) delete[] p;
+    return 0;
+}
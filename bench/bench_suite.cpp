@@ -0,0 +1,290 @@
+// Suite de mediciones de las rutas calientes de la shell, con resultados en JSON para comparar
+// entre versiones: tokenize/trim, resolve_alias, resolve_command_path, lanzar /bin/true con
+// execute_command_simple, caudal de una tubería de dos etapas (execute_with_pipe) y escalado de
+// parallel de 1 a N comandos.
+//
+// Uso:
+//   bench_suite [--json archivo] [--quick] [--max-jobs N] [--label texto]
+// Con CMake: 'cmake --build build --target bench' (deja build/bench_results.json).
+//
+// Cada resultado lleva su unidad y si es mejor más alto o más bajo ("better"), para que un script
+// pueda comparar dos archivos sin conocer cada medida.
+#include "parser.hpp"
+#include "builtins.hpp"
+#include "executor.hpp"
+#include "pathcache.hpp"
+#include "parallel.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+struct Result {
+    std::string name;
+    std::string unit;
+    bool higher_is_better;
+    double value;
+    long iterations;
+};
+
+static std::vector<Result> results;
+
+static double now_s() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const std::string &name, const std::string &unit, bool higher, double value, long iters) {
+    results.push_back({name, unit, higher, value, iters});
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(14) << std::fixed
+              << std::setprecision(unit == "x" ? 2 : unit == "ns/op" || unit == "us" ? 1 : 0) << value << ' ' << unit << '\n';
+}
+
+// Rango más cercano, como 'stats' (accounting.cpp)
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t rank = (size_t)std::ceil(p * v.size());
+    return v[rank > 0 ? std::min(rank, v.size()) - 1 : 0];
+}
+
+// Los comandos medidos escriben en stdout; se manda a /dev/null mientras corren
+struct QuietStdout {
+    int saved;
+    QuietStdout() {
+        std::cout.flush();
+        saved = dup(STDOUT_FILENO);
+        int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (fd >= 0) { dup2(fd, STDOUT_FILENO); close(fd); }
+    }
+    ~QuietStdout() {
+        if (saved >= 0) { dup2(saved, STDOUT_FILENO); close(saved); }
+    }
+};
+
+static void bench_tokenize(bool quick) {
+    std::vector<std::string> lines = {
+        "  ls -l /var/log/syslog  ",
+        "grep -n error /tmp/build-output-with-a-long-name.log | sort | uniq -c",
+        "gcc -O2 -Wall -Wextra -Iinclude -c src/executor.cpp -o build/executor.o",
+        "echo 'una frase con espacios' \"y otra \\\"citada\\\"\" fin",
+        "parallel -j 4 gzip a ;; gzip b ;; gzip c ;; gzip d",
+        "\t  cat datos.csv | cut -d , -f 2 | sort -n > salida.txt  \t",
+    };
+    size_t rounds = quick ? 20000 : 200000;
+    TokenArena arena;
+    size_t words = 0;
+    double t0 = now_s();
+    for (size_t r=0;r<rounds;++r)
+        for (const auto &l: lines) {
+            tokenize_into(trim_view(l), arena, false);
+            words += arena.words.size();
+        }
+    double s = now_s() - t0;
+    long n = (long)(rounds * lines.size());
+    report("tokenize_into+trim_view", "lines/s", true, n / s, n);
+    if (words == 0) std::cerr << "bench: tokenize no produjo palabras\n";
+
+    // trim() con copia, como lo usan los built-ins
+    size_t total = 0;
+    t0 = now_s();
+    for (size_t r=0;r<rounds;++r)
+        for (const auto &l: lines) total += trim(l).size();
+    s = now_s() - t0;
+    report("trim", "lines/s", true, n / s, n);
+    if (total == 0) std::cerr << "bench: trim devolvió vacío\n";
+
+    std::vector<std::string> out;
+    t0 = now_s();
+    for (size_t r=0;r<rounds/4;++r)
+        for (const auto &l: lines) out = tokenize(l, false);
+    s = now_s() - t0;
+    n = (long)(rounds / 4 * lines.size());
+    report("tokenize", "lines/s", true, n / s, n);
+}
+
+static void bench_alias(bool quick) {
+    // 64 aliases encadenados (como bench_alias.cpp), más una palabra que no es alias
+    for (int i=0;i<64;++i) {
+        std::string value = (i % 4 == 0 ? std::string("ls -l --color=never") : "a" + std::to_string(i-1) + " -h");
+        define_alias("a" + std::to_string(i), value);
+    }
+    long iters = quick ? 100000 : 1000000;
+    std::vector<std::string> names;
+    for (int i=0;i<64;++i) names.push_back("a" + std::to_string(i));
+    std::vector<std::string> tokens;
+    double t0 = now_s();
+    for (long i=0;i<iters;++i) {
+        tokens.assign({ names[i & 63], "arg1", "arg2" });
+        resolve_alias(tokens);
+    }
+    report("resolve_alias_hit", "ns/op", false, (now_s() - t0) * 1e9 / iters, iters);
+
+    t0 = now_s();
+    for (long i=0;i<iters;++i) {
+        tokens.assign({ "noalias", "arg1", "arg2" });
+        resolve_alias(tokens);
+    }
+    report("resolve_alias_miss", "ns/op", false, (now_s() - t0) * 1e9 / iters, iters);
+}
+
+static void bench_resolve(bool quick) {
+    // Primera búsqueda (recorre PATH) frente a las siguientes (tabla hash)
+    std::vector<std::string> cmds = { "ls", "cat", "sh", "grep", "sort", "wc", "head", "true" };
+    std::vector<double> cold;
+    for (int r=0;r<(quick ? 20 : 200);++r) {
+        path_cache_clear();
+        for (const auto &c: cmds) {
+            double t0 = now_s();
+            resolve_command_path(c);
+            cold.push_back((now_s() - t0) * 1e6);
+        }
+    }
+    report("resolve_command_path_cold_p50", "us", false, percentile(cold, 0.5), (long)cold.size());
+
+    long iters = quick ? 100000 : 1000000;
+    size_t len = 0;
+    double t0 = now_s();
+    for (long i=0;i<iters;++i) len += resolve_command_path(cmds[i & 7]).size();
+    report("resolve_command_path_hit", "ns/op", false, (now_s() - t0) * 1e9 / iters, iters);
+    if (len == 0) std::cerr << "bench: resolve_command_path no encontró nada en PATH\n";
+}
+
+static void bench_spawn(bool quick) {
+    int iters = quick ? 100 : 1000;
+    std::vector<double> lat;
+    lat.reserve(iters);
+    for (int i=0;i<iters;++i) {
+        double t0 = now_s();
+        execute_command_simple({ "/bin/true" }, false);
+        lat.push_back((now_s() - t0) * 1e6);
+    }
+    report("execute_command_simple_true_p50", "us", false, percentile(lat, 0.5), iters);
+    report("execute_command_simple_true_p99", "us", false, percentile(lat, 0.99), iters);
+}
+
+static void bench_pipe(bool quick) {
+    long long bytes = quick ? (256LL << 20) : (2LL << 30);
+    int reps = quick ? 1 : 3;
+    double best = 0;
+    for (int r=0;r<reps;++r) {
+        double t0 = now_s();
+        {
+            QuietStdout q;
+            execute_with_pipe({ "head", "-c", std::to_string(bytes), "/dev/zero" }, { "wc", "-c" }, false);
+        }
+        best = std::max(best, bytes / (now_s() - t0) / (1 << 20));
+    }
+    report("execute_with_pipe_head_wc", "MiB/s", true, best, reps);
+}
+
+static void bench_parallel(bool quick, int max_jobs) {
+    // Cada comando hace trabajo de CPU (~decenas de ms con sh); se lanzan k comandos con -j k
+    std::string spin = "sh -c 'i=0; while [ $i -lt " + std::string(quick ? "5000" : "20000") +
+                       " ]; do i=$((i+1)); done'";
+    double t1 = 0;
+    for (int k=1; k<=max_jobs; k = (k < max_jobs && k * 2 > max_jobs ? max_jobs : k * 2)) {
+        std::vector<std::string> cmds(k, spin);
+        RunnerOptions opts;
+        opts.max_jobs = k;
+        opts.verbose = false;
+        size_t next = 0;
+        CommandSource source = [&](std::vector<std::string> &tokens, std::vector<bool> &literal, std::string &display) {
+            if (next == cmds.size()) return false;
+            display = cmds[next++];
+            tokens = tokenize(display, false, &literal);
+            return true;
+        };
+        double t0 = now_s();
+        int failed;
+        {
+            QuietStdout q;
+            failed = run_jobs(source, opts);
+        }
+        double s = now_s() - t0;
+        if (failed) std::cerr << "bench: parallel con " << k << " comandos tuvo " << failed << " fallos\n";
+        if (k == 1) t1 = s;
+        report("parallel_" + std::to_string(k) + "_wall", "ms", false, s * 1e3, k);
+        report("parallel_" + std::to_string(k) + "_speedup", "x", true, t1 * k / s, k);
+        if (k == max_jobs) break;
+    }
+}
+
+static std::string json_escape(const std::string &s) {
+    std::string r;
+    for (char c: s) {
+        if (c == '"' || c == '\\') { r += '\\'; r += c; }
+        else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            r += buf;
+        } else r += c;
+    }
+    return r;
+}
+
+static bool write_json(const std::string &path, const std::string &label, bool quick) {
+    std::ofstream out(path);
+    if (!out) return false;
+    char stamp[32];
+    time_t t = time(nullptr);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+    struct utsname u;
+    uname(&u);
+    out << "{\n  \"suite\": \"mini_shell\",\n  \"timestamp\": \"" << stamp << "\",\n"
+        << "  \"label\": \"" << json_escape(label) << "\",\n"
+        << "  \"quick\": " << (quick ? "true" : "false") << ",\n"
+        << "  \"host\": {\"name\": \"" << json_escape(u.nodename) << "\", \"kernel\": \""
+        << json_escape(u.release) << "\", \"cpus\": " << online_cpu_count() << "},\n"
+        << "  \"results\": [\n";
+    out << std::setprecision(6);
+    for (size_t i=0;i<results.size();++i) {
+        const Result &r = results[i];
+        out << "    {\"name\": \"" << json_escape(r.name) << "\", \"unit\": \"" << r.unit
+            << "\", \"better\": \"" << (r.higher_is_better ? "higher" : "lower")
+            << "\", \"value\": " << r.value << ", \"iterations\": " << r.iterations << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+int main(int argc, char **argv) {
+    std::string json_path = "bench_results.json", label;
+    bool quick = false;
+    int max_jobs = std::max(4, 2 * online_cpu_count()); // Con 1-2 CPUs igual interesa ver la curva hasta 4
+    for (int i=1;i<argc;++i) {
+        std::string a = argv[i];
+        if (a == "--json" && i + 1 < argc) json_path = argv[++i];
+        else if (a == "--label" && i + 1 < argc) label = argv[++i];
+        else if (a == "--max-jobs" && i + 1 < argc) max_jobs = std::max(1, atoi(argv[++i]));
+        else if (a == "--quick") quick = true;
+        else {
+            std::cerr << "uso: " << argv[0] << " [--json archivo] [--quick] [--max-jobs N] [--label texto]\n";
+            return 2;
+        }
+    }
+
+    bench_tokenize(quick);
+    bench_alias(quick);
+    bench_resolve(quick);
+    bench_spawn(quick);
+    bench_pipe(quick);
+    bench_parallel(quick, max_jobs);
+
+    if (!write_json(json_path, label, quick)) {
+        perror(json_path.c_str());
+        return 1;
+    }
+    std::cout << "resultados: " << json_path << '\n';
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Medición: repartir un flujo grande a un archivo y a la etapa siguiente.
+//   tee(1):  head -c N /dev/zero | /usr/bin/tee F | wc -c   (un proceso más que copia por espacio de usuario)
+//   relay:   head -c N /dev/zero > F | wc -c                (tee(2)/splice(2) desde un hilo de la shell)
+// Se informa tiempo real, MB/s y CPU de los hijos y de la shell (el repartidor corre en la shell).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 bench/bench_tee.cpp $(ls src/*.cpp | grep -v main.cpp) -Iinclude -o bench_tee -pthread
+#include "executor.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+
+static double cpu_ms(int who) {
+    struct rusage ru;
+    getrusage(who, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000.0 + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000.0;
+}
+
+static void run(const char *label, const std::vector<std::vector<std::string>> &stages, double mb) {
+    double self0 = cpu_ms(RUSAGE_SELF), children0 = cpu_ms(RUSAGE_CHILDREN);
+    auto t0 = std::chrono::steady_clock::now();
+    int status = execute_pipeline(stages, false);
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << std::left << std::setw(8) << label << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << s << std::setw(10) << std::setprecision(0) << mb / s
+              << std::setw(14) << cpu_ms(RUSAGE_CHILDREN) - children0
+              << std::setw(12) << cpu_ms(RUSAGE_SELF) - self0
+              << (status != 0 ? "   (estado " + std::to_string(status) + ")" : "") << "\n";
+}
+
+int main(int argc, char **argv) {
+    long long bytes = (argc > 1 ? atoll(argv[1]) : 4LL << 30);
+    std::string file = (argc > 2 ? argv[2] : "/tmp/bench_tee.out");
+    int reps = (argc > 3 ? atoi(argv[3]) : 2);
+    std::string n = std::to_string(bytes);
+    double mb = bytes / 1e6;
+    std::cout << mb << " MB por ejecución, destino " << file << "\n"
+              << "variante   real_s      MB/s  cpu_hijos_ms  cpu_shell_ms\n";
+    for (int r=0;r<reps;++r) {
+        run("tee(1)", {{"head", "-c", n, "/dev/zero"}, {"/usr/bin/tee", file}, {"wc", "-c", ">", "/dev/null"}}, mb);
+        run("relay", {{"head", "-c", n, "/dev/zero", ">", file}, {"wc", "-c", ">", "/dev/null"}}, mb);
+    }
+    unlink(file.c_str());
+    return 0;
+}
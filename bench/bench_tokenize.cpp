@@ -0,0 +1,70 @@
+// Medición: líneas/segundo del tokenizador anterior (istringstream + trim con copia)
+// frente a tokenize() (copia final a std::string) y tokenize_into() (arena reutilizado).
+//
+// Compilar:
+//   g++ -std=c++17 -O2 bench/bench_tokenize.cpp $(ls src/*.cpp | grep -v main.cpp) -Iinclude -o bench_tokenize -pthread
+#include "parser.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+
+// Implementación anterior, copiada para comparar
+static std::string legacy_trim(const std::string &s) {
+    size_t a = s.find_first_not_of(" \t\n\r");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t\n\r");
+    return s.substr(a, b - a + 1);
+}
+
+static std::vector<std::string> legacy_tokenize(const std::string &line) {
+    std::vector<std::string> tokens;
+    std::istringstream iss(line);
+    std::string t;
+    while (iss >> t) tokens.push_back(t);
+    return tokens;
+}
+
+static double now_s() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv) {
+    size_t rounds = (argc > 1 ? std::stoul(argv[1]) : 200);
+    // Líneas típicas de un script generado
+    std::vector<std::string> lines = {
+        "  ls -l /var/log/syslog  ",
+        "grep -n error /tmp/build-output-with-a-long-name.log | sort | uniq -c",
+        "cp /home/user/data/input_0001.csv /home/user/data/backup/input_0001.csv",
+        "echo a b c d e f g h i j k l m n o p",
+        "gzip -9 -k report.txt > /dev/null",
+    };
+    size_t total = rounds * 10000;
+    size_t sink = 0;
+
+    double t0 = now_s();
+    for (size_t i=0;i<total;++i) sink += legacy_tokenize(legacy_trim(lines[i % lines.size()])).size();
+    double legacy = total / (now_s() - t0);
+
+    t0 = now_s();
+    for (size_t i=0;i<total;++i) sink += tokenize(trim(lines[i % lines.size()])).size();
+    double wrapper = total / (now_s() - t0);
+
+    TokenArena arena;
+    t0 = now_s();
+    for (size_t i=0;i<total;++i) {
+        tokenize_into(trim_view(lines[i % lines.size()]), arena);
+        sink += arena.words.size();
+    }
+    double direct = total / (now_s() - t0);
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "istringstream  : " << legacy << " líneas/s\n"
+              << "tokenize()     : " << wrapper << " líneas/s\n"
+              << "tokenize_into(): " << direct << " líneas/s\n"
+              << "(" << sink << " palabras)\n";
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef ACCOUNTING_HPP
+#define ACCOUNTING_HPP
+
+#include <string>
+#include <sys/resource.h>
+
+// Recursos consumidos por un comando en primer plano (suma de todas las etapas si es una tubería)
+struct CommandUsage {
+    double wall_ms = 0, user_ms = 0, sys_ms = 0;
+    long maxrss_kb = 0;         // Máximo entre las etapas
+    long majflt = 0, minflt = 0;
+    long nvcsw = 0, nivcsw = 0; // Cambios de contexto voluntarios / involuntarios
+};
+
+extern CommandUsage last_usage; // Último comando en primer plano
+
+// Medición de 'time' sobre una línea completa: suma los recursos de todos los comandos que se
+// cierran mientras está activa (cada hijo de parallel/pmap, las etapas, los $(...)) y los que
+// consume la propia shell (built-ins). Se pueden anidar.
+struct UsageTimer {
+    double start_ms = 0;
+    struct rusage self_start;
+    CommandUsage children;
+    UsageTimer *outer = nullptr;
+};
+void usage_timer_start(UsageTimer &t);
+CommandUsage usage_timer_stop(UsageTimer &t); // Total desde usage_timer_start (wall_ms incluido)
+extern bool stats_enabled;      // 'stats on': acumula por nombre de comando
+
+// Suma el rusage de un hijo recogido con wait4
+void usage_add(CommandUsage &u, const struct rusage &ru);
+// Cierra la medición de un comando: actualiza last_usage y, si stats está activo, los agregados
+void account_command(const std::string &name, const CommandUsage &u);
+void print_usage(const CommandUsage &u);
+void stats_print();
+void stats_reset();
+
+#endif
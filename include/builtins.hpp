@@ -4,17 +4,36 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <mutex>
 
-extern std::vector<std::string> history_list;
-extern std::map<std::string,std::string> aliases;
-extern std::mutex builtins_mutex;
+// Alias guardado ya tokenizado y expandido recursivamente (se recalcula al definir cualquier alias).
+// Las palabras con $(...), $? o comodines se guardan sin interpretar y se expanden en cada uso.
+struct AliasEntry {
+    std::string text;                // Valor tal como se definió
+    std::vector<std::string> words;  // Expansión final lista para sustituir tokens[0]
+    std::vector<bool> literal;       // Marca de cada palabra de words (llevaba comillas: no es operador)
+    std::vector<bool> dynamic;       // La palabra es texto sin tokenizar: resolve_alias la expande
+    bool has_dynamic = false;
+};
+using AliasMap = std::map<std::string, AliasEntry>;
+
+extern std::mutex builtins_mutex; // Serializa a quienes definen aliases (los lectores no bloquean)
+
+// Instantánea inmutable de los aliases: lectura sin bloqueo (intercambio atómico de shared_ptr, estilo RCU)
+std::shared_ptr<const AliasMap> alias_snapshot();
+// Define name=value; false (e informa) si crea un ciclo
+bool define_alias(const std::string &name, const std::string &value);
+
+// Un built-in recibe sus argumentos ya sin redirecciones y devuelve su código de salida
+using BuiltinFn = int (*)(const std::vector<std::string> &tokens);
 
 bool is_builtin(const std::string &cmd);
-void handle_builtin(const std::vector<std::string> &tokens);
+int handle_builtin(const std::vector<std::string> &tokens);
 void print_help();
-bool resolve_alias(std::vector<std::string> &tokens);
-// parallel: acepta el resto de la línea (después de "paralelo") y divide los comandos por ";;"
-void run_parallel_from_line(const std::string &rest);
+// Sustituye tokens[0] por su alias; si literal no es nulo, se ajusta a las nuevas palabras
+bool resolve_alias(std::vector<std::string> &tokens, std::vector<bool> *literal = nullptr);
+// parallel: acepta el resto de la línea (después de "parallel", con "-j N" opcional) y divide los comandos por ";;"
+int run_parallel_from_line(const std::string &rest); // 0 si todos terminaron bien
 
 #endif
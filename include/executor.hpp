@@ -3,10 +3,54 @@
 
 #include <string>
 #include <vector>
+#include <string_view>
+#include <sys/types.h>
 
-void execute_command_simple(std::vector<std::string> tokens, bool background);
-void execute_with_pipe(std::vector<std::string> left_tokens, std::vector<std::string> right_tokens, bool background);
+// Destino de un '>' (TRUNC) o '>>' (APPEND)
+struct OutputTarget {
+    std::string path;
+    bool append = false;
+};
+
+// Redirecciones de un comando: archivo de entrada y destinos de salida.
+// Con varios destinos, o con destinos y un '|' a continuación, la salida va a todos (relay.hpp).
+struct Redirections {
+    std::string infile;
+    std::vector<OutputTarget> outputs;
+};
+
+// Capacidad pedida para cada pipe con F_SETPIPE_SZ (0 = tamaño por defecto del kernel)
+extern int pipe_buffer_size;
+
+// literal[i] marca que tokens[i] llevaba comillas: aunque sea "<", ">" o ">>" es un argumento.
+// Vacío = ninguna palabra lo lleva (tokens construidos a mano).
+int execute_command_simple(std::vector<std::string> tokens, bool background, std::vector<bool> literal = {});
+int execute_with_pipe(std::vector<std::string> left_tokens, std::vector<std::string> right_tokens, bool background);
+// Ejecuta N comandos conectados por pipes como un único trabajo; devuelve el estado del último.
+// literal, si no está vacío, tiene una marca por palabra de cada etapa (como en execute_command_simple).
+int execute_pipeline(std::vector<std::vector<std::string>> stages, bool background, std::vector<std::vector<bool>> literal = {});
 std::string resolve_command_path(const std::string &cmd);
 bool file_exists_and_executable(const std::string &path);
+// Separa los tokens de redirección (<, >, >>) de los argumentos; false si la sintaxis es inválida.
+// Las palabras marcadas en literal son siempre argumentos.
+bool split_redirections(const std::vector<std::string> &tokens, std::vector<std::string> &argv_tokens, Redirections &redir,
+                        const std::vector<bool> &literal = {});
+// Lanza el comando con posix_spawn (sin copiar la memoria de la shell); in_fd/out_fd = -1 para heredar
+pid_t spawn_command(const std::vector<std::string> &argv_tokens, const Redirections &redir, int in_fd, int out_fd);
+// Igual que spawn_command, sobre un argv ya terminado en nullptr (p. ej. el de TokenArena)
+pid_t spawn_argv(char *const argv[], const Redirections &redir, int in_fd, int out_fd);
+// Lanza y espera un comando externo sin redirecciones directamente desde su argv
+int execute_argv(char *const argv[], bool background);
+struct CommandUsage;
+// Ejecuta un built-in en la shell aplicando sus redirecciones (<, >, >>) temporalmente
+int run_builtin(const std::vector<std::string> &tokens, const std::vector<bool> &literal = {});
+// Lee fd hasta EOF en el buffer de captura de $(...), que se reutiliza entre llamadas;
+// la vista es válida hasta la siguiente captura
+std::string_view read_capture(int fd);
+// Libera el buffer de captura si una salida enorme lo dejó por encima de 64 MiB
+void capture_trim();
+// Espera a un hijo y devuelve su código de salida (128+señal si terminó por señal);
+// si usage no es nulo, le suma el rusage del hijo (wait4)
+int wait_child(pid_t pid, CommandUsage *usage = nullptr);
 
 #endif
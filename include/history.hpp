@@ -0,0 +1,16 @@
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <string>
+#include <cstddef>
+
+// Historial persistente: archivo de datos de solo anexado (una entrada por línea) más un índice
+// de offsets de 8 bytes. Ambos se proyectan con mmap, así que abrirlo no depende de su tamaño.
+// Ruta: $MINISHELL_HISTFILE o ~/.mini_shell_history (índice: <ruta>.idx).
+bool history_open();
+void history_append(const std::string &line); // Seguro con varias shells a la vez (flock)
+size_t history_count();
+void history_print_last(size_t n);            // n = 0: todo
+void history_search(const std::string &pattern, bool prefix_only);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "placement.hpp"
+
+// Opciones del bucle de trabajos compartido por 'parallel' y 'pmap'
+struct RunnerOptions {
+    int max_jobs = 0;     // Hijos simultáneos como máximo (0 = uno por CPU disponible para los hijos)
+    bool capture = false; // Captura el stdout de cada hijo y lo emite entero (sin mezclar líneas)
+    bool ordered = true;  // Con captura: emite en orden de entrada (false = en orden de terminación)
+    bool verbose = true;  // Informa la salida de cada comando (false = solo los fallos)
+    int stdin_fd = -1;    // STDIN de los hijos (-1 = heredar el de la shell)
+    Placement placement;  // --pin, --cpus, --reserve, --nice, --ionice
+};
+
+// Devuelve el siguiente comando (tokens, su marca de palabras entre comillas como en
+// TokenArena::literal, y texto para los informes); false cuando no hay más
+using CommandSource = std::function<bool(std::vector<std::string> &tokens, std::vector<bool> &literal, std::string &display)>;
+
+// Número de CPUs en línea (límite por defecto de 'parallel -j' y 'pmap -j')
+int online_cpu_count();
+// Ejecuta los comandos de source con como máximo opts.max_jobs hijos a la vez desde un solo hilo
+// (pidfd + epoll); devuelve el número de fallos
+int run_jobs(const CommandSource &source, const RunnerOptions &opts);
+// Atajo para una lista fija de líneas de comando
+int run_bounded(const std::vector<std::string> &cmds, int max_jobs, const Placement &placement = Placement());
+// pmap [-j N] [-c] [colocación] cmd ... {} ... < lista (la lista se lee de STDIN)
+int run_pmap(const std::vector<std::string> &tokens);
+
+#endif
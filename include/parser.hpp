@@ -2,9 +2,65 @@
 #define PARSER_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Palabras de una línea sobre un buffer reutilizable: una sola pasada y ninguna std::string por palabra.
+// Las vistas y argv apuntan a buf y son válidos hasta el siguiente tokenize_into con el mismo arena.
+struct TokenArena {
+    std::string buf;                     // Palabras contiguas, cada una terminada en '\0'
+    std::vector<size_t> starts;          // Inicio de cada palabra en buf
+    std::vector<std::string_view> words; // Vistas sobre buf (sin el '\0')
+    std::vector<char*> argv;             // argv listo para exec (terminado en nullptr)
+    std::vector<bool> literal;           // Por palabra: llevó comillas o '\' o viene de $(...) (nunca es un operador |, <, >, >>)
+    std::vector<size_t> quoted_meta;     // Comodines entre comillas de la palabra en curso (posiciones en buf)
+    std::string pattern;                 // Auxiliares de la expansión de comodines
+    std::vector<std::string> matches;
+    void clear();
+    void release(); // clear() y además devuelve la memoria (tras una línea enorme)
+};
+
 std::string trim(const std::string &s);
-std::vector<std::string> tokenize(const std::string &line);
+std::string_view trim_view(std::string_view s);
+// Ejecuta el texto de un $(...) y deja en output su stdout (válido hasta la siguiente sustitución).
+// La instala quien sabe ejecutar líneas (main); devuelve false si no se pudo lanzar.
+using SubstitutionFn = bool (*)(std::string_view command, std::string_view &output);
+extern SubstitutionFn command_substitution;
+extern int last_status; // Estado de salida del último comando ($?); lo actualiza quien ejecuta las listas
+
+// Un comando de una lista 'a ; b && c || d' y el operador que lo une al anterior
+enum class ListOp { Seq, And, Or };
+struct ListItem {
+    ListOp op;             // Seq para el primero, tras ';' y tras '&'
+    std::string_view text; // Sin espacios alrededor; conserva el '&' final de un comando en segundo plano
+};
+// Divide la línea por ';', '&&', '||' y '&' fuera de comillas, '\' y $(...). ';;' (separador de
+// parallel) no divide. Devuelve false (e informa) si a un operador le falta el comando.
+bool split_command_list(std::string_view line, std::vector<ListItem> &items);
+// Si la línea acaba en un '&' sin comillas ni '\' (segundo plano), lo quita junto con los espacios
+bool strip_background(std::string_view &line);
+// Divide en palabras por espacios sin interpretarlas (cada una con sus comillas y '\'). dynamic[k]
+// indica que la palabra lleva $(...), $? o comodines sin comillas: su valor depende de cuándo se
+// tokenice. Devuelve false (e informa) si una comilla o un $( no se cierra.
+bool split_raw_words(std::string_view line, std::vector<std::string> &words, std::vector<bool> &dynamic);
+
+// Divide en palabras separadas por espacios; entiende comillas simples, dobles, '\', $(...) y $?.
+// Expande *, ? y [...] fuera de comillas salvo con expand_globs=false.
+// Devuelve false (e informa) si queda una comilla sin cerrar.
+bool tokenize_into(std::string_view line, TokenArena &arena, bool expand_globs = true);
+// Copia en std::string; si literal no es nulo, recibe la marca de cada palabra (ver TokenArena::literal)
+std::vector<std::string> tokenize(const std::string &line, bool expand_globs = true, std::vector<bool> *literal = nullptr);
+// Operador de tubería o redirección: "|", "<", ">" o ">>" (sin mirar si llevaba comillas)
+bool is_operator_word(std::string_view w);
+
+// Lector de líneas sobre un descriptor con un buffer grande (sin un read() por línea)
+struct LineReader {
+    int fd;
+    std::vector<char> buf;
+    size_t start = 0, end = 0; // Datos pendientes en buf[start, end)
+    bool eof = false;
+    explicit LineReader(int fd_, size_t capacity = 1 << 16) : fd(fd_), buf(capacity) {}
+    bool next(std::string &line); // false al llegar a EOF sin más datos
+};
 
 #endif
@@ -0,0 +1,14 @@
+#ifndef PATHCACHE_HPP
+#define PATHCACHE_HPP
+
+#include <string>
+
+// Tabla de rutas resueltas en el padre (equivalente al 'hash' de bash).
+// Se invalida si cambia PATH o el mtime de algún directorio de PATH.
+std::string path_cache_lookup(const std::string &cmd); // "" si no está en PATH
+void path_cache_forget(const std::string &cmd);
+void path_cache_clear();
+bool path_cache_warm(const std::string &cmd);
+void path_cache_print();
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+#include <string>
+#include <vector>
+#include <sched.h>          // cpu_set_t
+#include <sys/types.h>
+
+// Colocación de los hijos de parallel/pmap: CPUs (sched_setaffinity), nice e ionice
+struct Placement {
+    bool pin = false;        // --pin: un CPU por hijo, el menos ocupado de la lista
+    std::vector<int> cpus;   // --cpus 0-3,8: CPUs de los hijos (vacío = los de la shell)
+    bool reserve = false;    // --reserve: un CPU queda solo para la shell
+    bool set_nice = false;   // --nice N
+    int nice = 0;
+    int ioprio_class = -1;   // --ionice idle|be[:N]|rt[:N] (-1 = sin cambio)
+    int ioprio_level = 4;
+    bool active() const { return pin || !cpus.empty() || reserve || set_nice || ioprio_class >= 0; }
+};
+
+// Estado de una ejecución con colocación (dura lo que dura run_jobs)
+struct PlacementRun {
+    bool active = false;
+    Placement opts;
+    std::vector<int> child_cpus;  // CPUs disponibles para los hijos
+    std::vector<int> load;        // Hijos vivos por CPU (con --pin)
+    std::vector<unsigned long> launched; // Hijos lanzados por CPU (informe)
+    int reserved_cpu = -1;
+    cpu_set_t shell_mask;         // Afinidad de la shell durante la ejecución
+    cpu_set_t original_mask;      // Afinidad previa, restaurada al terminar
+};
+
+// Lee una de las opciones de colocación en words[i]; devuelve las palabras consumidas,
+// 0 si no es una opción de colocación y -1 (tras informar) si su argumento no es válido
+int placement_option(const std::vector<std::string> &words, size_t i, Placement &p);
+bool parse_cpu_list(const std::string &text, std::vector<int> &cpus); // "0-3,8"
+std::string format_cpu_list(const std::vector<int> &cpus);
+std::vector<int> affinity_cpus(); // CPUs permitidos al hilo actual
+
+// Calcula los CPUs de los hijos y, con --reserve, fija la shell a su CPU; false si no hay nada que hacer
+bool placement_begin(const Placement &p, PlacementRun &run);
+// Antes del spawn: el hijo hereda la afinidad del hilo que lo crea. Devuelve el CPU elegido (-1 sin --pin)
+int placement_acquire(PlacementRun &run);
+// Tras el spawn: devuelve la afinidad de la shell y aplica nice/ionice al hijo
+void placement_spawned(PlacementRun &run, pid_t pid);
+void placement_release(PlacementRun &run, int slot);
+void placement_end(PlacementRun &run);
+// cpuinfo: CPUs, afinidad, nice e ionice de la shell y el reparto del último parallel/pmap
+void placement_print();
+
+#endif
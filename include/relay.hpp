@@ -0,0 +1,20 @@
+#ifndef RELAY_HPP
+#define RELAY_HPP
+
+#include <vector>
+
+// Reparto de la salida de un comando entre varios destinos (cmd > a.log >> b.log | siguiente).
+// Un hilo de la shell duplica el pipe del comando con tee(2) y lo vuelca a cada destino con
+// splice(2): los datos no pasan por buffers de usuario. Los destinos '>>' (O_APPEND) y los que
+// no admiten splice, como una terminal, se copian con read/write.
+// Toma posesión de los descriptores de sinks y devuelve el extremo de escritura (O_CLOEXEC)
+// que debe recibir el comando como stdout, o -1 si falla (y cierra los sinks).
+int relay_start(const std::vector<int> &sinks);
+// Espera a los repartidores creados por el comando en curso (los destinos quedan completos)
+void relay_join_pending();
+// Los del comando en curso siguen solos (comando en segundo plano)
+void relay_detach_pending();
+// En un hijo recién creado con fork: olvida los repartidores heredados, que son hilos del padre
+void relay_forget_inherited();
+
+#endif
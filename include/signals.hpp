@@ -2,11 +2,30 @@
 #define SIGNALS_HPP
 
 #include <signal.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
 
 extern volatile sig_atomic_t child_terminated;
+extern volatile sig_atomic_t interrupt_received; // Ctrl+C desde la última vez que alguien la puso a 0
 
 void sigchld_handler(int);
 void sigint_handler(int);
 void reap_children_nonblocking();
 
+// true en un hijo creado con fork_child: 'salir' termina con _exit (sin los atexit de la shell)
+extern bool forked_child;
+// fork para código de la shell (un built-in en una etapa de tubería): la tabla de trabajos se
+// bloquea durante el fork (pthread_atfork), así que el hijo no hereda su mutex tomado por el hilo
+// recolector. En el hijo, SIGINT vuelve a SIG_DFL.
+pid_t fork_child();
+
+// Tabla de trabajos en segundo plano. Un hilo recolector vigila el pidfd de cada proceso
+// con epoll y lo recoge en cuanto termina, aunque la shell esté esperando entrada.
+int job_add(const std::vector<pid_t> &pids, const std::string &cmdline); // Devuelve el id del trabajo
+void jobs_print();
+int job_wait(int id);  // Espera al trabajo id (-1 = todos) y devuelve el estado de su última etapa
+int job_last_id();     // Trabajo más reciente (0 si no hay)
+std::string job_command(int id);
+
 #endif
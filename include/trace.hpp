@@ -0,0 +1,36 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <sys/types.h>
+
+// Línea de tiempo de la shell en formato Chrome trace-event (se abre en Perfetto o chrome://tracing).
+// Cada hilo escribe en su propio buffer circular con marcas de CLOCK_MONOTONIC; con la traza
+// desactivada cada punto de medida cuesta una lectura atómica relajada.
+extern std::atomic<bool> trace_enabled;
+
+uint64_t trace_now_ns();
+bool trace_start(const std::string &file); // Vacía los buffers y empieza a registrar
+bool trace_stop();                         // Deja de registrar y escribe el JSON
+const std::string &trace_file();
+void trace_thread_name(const char *name);  // Nombre del hilo actual en la línea de tiempo
+// Intervalo [start_ns, ahora) en el hilo actual
+void trace_complete(const char *name, uint64_t start_ns);
+// Vida de un hijo: desde el spawn (start_ns, o ahora si es 0) hasta que se recoge (una pista por proceso)
+void trace_child_start(pid_t pid, const char *name, uint64_t start_ns = 0);
+void trace_child_end(pid_t pid);
+
+// Mide el bloque en el que se declara: TraceScope span("tokenize");
+struct TraceScope {
+    const char *name;
+    uint64_t start;
+    explicit TraceScope(const char *n)
+        : name(n), start(trace_enabled.load(std::memory_order_relaxed) ? trace_now_ns() : 0) {}
+    ~TraceScope() { if (start) trace_complete(name, start); }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope &operator=(const TraceScope&) = delete;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef WILDCARD_HPP
+#define WILDCARD_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Expansión de comodines (*, ?, [...]) sobre una caché de listados de directorio.
+// Los directorios se leen con getdents64 y se guardan ordenados junto con su mtime:
+// mientras el directorio no cambie, repetir un patrón no vuelve a leerlo.
+bool has_wildcards(std::string_view word);
+// Añade a out las rutas que coinciden, en orden; false si no hay ninguna.
+// '\' escapa el carácter siguiente (así llegan los comodines entre comillas).
+bool glob_expand(const std::string &pattern, std::vector<std::string> &out);
+bool glob_match(std::string_view pattern, std::string_view name);
+void glob_cache_clear();
+
+#endif
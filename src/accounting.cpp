@@ -0,0 +1,139 @@
+#include "accounting.hpp"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <vector>
+#include <algorithm>    // std::nth_element
+#include <cmath>        // std::ceil
+#include <random>
+#include <chrono>
+
+CommandUsage last_usage;
+bool stats_enabled = false;
+static UsageTimer *active_timer = nullptr; // 'time' en curso más interno
+
+// Agregados por nombre de comando
+struct CommandStats {
+    unsigned long count = 0;
+    double total_wall_ms = 0, total_cpu_ms = 0;
+    long max_rss_kb = 0;
+    std::vector<double> samples; // Muestra de latencias (reservorio acotado)
+};
+
+static std::map<std::string, CommandStats> stats_table;
+static const size_t max_samples = 4096; // Memoria acotada aunque un comando se repita millones de veces
+static std::mt19937 rng(12345);
+
+static double tv_ms(const struct timeval &tv) {
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+void usage_add(CommandUsage &u, const struct rusage &ru) {
+    u.user_ms += tv_ms(ru.ru_utime);
+    u.sys_ms += tv_ms(ru.ru_stime);
+    u.maxrss_kb = std::max(u.maxrss_kb, ru.ru_maxrss);
+    u.majflt += ru.ru_majflt;
+    u.minflt += ru.ru_minflt;
+    u.nvcsw += ru.ru_nvcsw;
+    u.nivcsw += ru.ru_nivcsw;
+}
+
+static double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void usage_timer_start(UsageTimer &t) {
+    t.children = CommandUsage();
+    getrusage(RUSAGE_SELF, &t.self_start);
+    t.start_ms = now_ms();
+    t.outer = active_timer;
+    active_timer = &t;
+}
+
+CommandUsage usage_timer_stop(UsageTimer &t) {
+    active_timer = t.outer;
+    CommandUsage u = t.children;
+    u.wall_ms = now_ms() - t.start_ms;
+    // Lo que hizo la propia shell (built-ins, lanzar y esperar) se suma a lo de los hijos
+    struct rusage self;
+    getrusage(RUSAGE_SELF, &self);
+    u.user_ms += tv_ms(self.ru_utime) - tv_ms(t.self_start.ru_utime);
+    u.sys_ms += tv_ms(self.ru_stime) - tv_ms(t.self_start.ru_stime);
+    u.majflt += self.ru_majflt - t.self_start.ru_majflt;
+    u.minflt += self.ru_minflt - t.self_start.ru_minflt;
+    u.nvcsw += self.ru_nvcsw - t.self_start.ru_nvcsw;
+    u.nivcsw += self.ru_nivcsw - t.self_start.ru_nivcsw;
+    if (u.maxrss_kb == 0) u.maxrss_kb = self.ru_maxrss; // Sin hijos: el máximo de la shell
+    return u;
+}
+
+void account_command(const std::string &name, const CommandUsage &u) {
+    last_usage = u;
+    for (UsageTimer *t = active_timer; t; t = t->outer) {
+        CommandUsage &c = t->children;
+        c.user_ms += u.user_ms;
+        c.sys_ms += u.sys_ms;
+        c.maxrss_kb = std::max(c.maxrss_kb, u.maxrss_kb);
+        c.majflt += u.majflt;
+        c.minflt += u.minflt;
+        c.nvcsw += u.nvcsw;
+        c.nivcsw += u.nivcsw;
+    }
+    if (!stats_enabled || name.empty()) return;
+    CommandStats &s = stats_table[name];
+    ++s.count;
+    s.total_wall_ms += u.wall_ms;
+    s.total_cpu_ms += u.user_ms + u.sys_ms;
+    s.max_rss_kb = std::max(s.max_rss_kb, u.maxrss_kb);
+    // Muestreo de reservorio: cada ejecución tiene la misma probabilidad de quedar en la muestra
+    if (s.samples.size() < max_samples) s.samples.push_back(u.wall_ms);
+    else {
+        std::uniform_int_distribution<unsigned long> pick(0, s.count - 1);
+        unsigned long j = pick(rng);
+        if (j < max_samples) s.samples[j] = u.wall_ms;
+    }
+}
+
+void print_usage(const CommandUsage &u) {
+    std::cerr << std::fixed << std::setprecision(3)
+              << "real    " << u.wall_ms / 1000.0 << "s\n"
+              << "user    " << u.user_ms / 1000.0 << "s\n"
+              << "sys     " << u.sys_ms / 1000.0 << "s\n"
+              << "maxrss  " << u.maxrss_kb << " KiB\n"
+              << "faults  " << u.majflt << " mayores, " << u.minflt << " menores\n"
+              << "ctxsw   " << u.nvcsw << " voluntarios, " << u.nivcsw << " involuntarios\n";
+    std::cerr.unsetf(std::ios::floatfield);
+}
+
+// Rango más cercano: el menor valor con al menos el p de las muestras a su izquierda (con dos
+// muestras, p99 es la mayor). La misma regla que bench/.
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p * v.size()));
+    size_t k = rank > 0 ? std::min(rank, v.size()) - 1 : 0;
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+void stats_print() {
+    if (stats_table.empty()) { std::cout << "stats: sin datos" << (stats_enabled ? "" : " (use 'stats on')") << "\n"; return; }
+    std::cout << std::left << std::setw(20) << "comando" << std::right
+              << std::setw(8) << "n" << std::setw(11) << "p50 ms" << std::setw(11) << "p99 ms"
+              << std::setw(12) << "total ms" << std::setw(12) << "cpu ms" << std::setw(12) << "maxrss KiB" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto &p: stats_table) {
+        const CommandStats &s = p.second;
+        std::cout << std::left << std::setw(20) << p.first << std::right
+                  << std::setw(8) << s.count
+                  << std::setw(11) << percentile(s.samples, 0.50)
+                  << std::setw(11) << percentile(s.samples, 0.99)
+                  << std::setw(12) << s.total_wall_ms
+                  << std::setw(12) << s.total_cpu_ms
+                  << std::setw(12) << s.max_rss_kb << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+void stats_reset() {
+    stats_table.clear();
+}
@@ -1,25 +1,27 @@
 #include "builtins.hpp"
 #include "executor.hpp"
 #include "parser.hpp"
+#include "pathcache.hpp"
+#include "parallel.hpp"
+#include "signals.hpp"
+#include "accounting.hpp"
+#include "history.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <iomanip>
 #include <cstdlib>      // Para exit(), getenv()
+#include <climits>      // Para INT_MAX (pipesize)
 #include <unistd.h>     // Para getcwd(), chdir()
-#include <pthread.h>    // Para hilos POSIX (parallel)
 #include <vector>
 #include <sstream>
 #include <fstream>      // Para leer /proc/self/status (meminfo)
 #include <map>          // Para std::map (aliases)
+#include <unordered_map> // Para el registro de built-ins
 #include <mutex>        // Para std::mutex (sincronización)
+#include <algorithm>    // Para std::find
 
-std::vector<std::string> history_list; // Historial de comandos
-std::map<std::string,std::string> aliases; // Alias definidos
-std::mutex builtins_mutex; // Mutex para proteger history y aliases
-
-// Comprueba si el comando es un built-in
-bool is_builtin(const std::string &cmd) {
-    return (cmd=="salir" || cmd=="cd" || cmd=="pwd" || cmd=="help" || cmd=="history" || cmd=="alias" || cmd=="parallel" || cmd=="meminfo");
-}
+std::mutex builtins_mutex; // Mutex para serializar las definiciones de aliases
+static std::shared_ptr<const AliasMap> alias_table = std::make_shared<const AliasMap>(); // Alias definidos
 
 // Muestra la ayuda de los comandos built-in
 void print_help() {
@@ -27,120 +29,384 @@ void print_help() {
     std::cout << "  salir            : salir de la shell\n";
     std::cout << "  cd <dir>         : cambiar directorio\n";
     std::cout << "  pwd              : mostrar directorio actual\n";
-    std::cout << "  history          : lista comandos ejecutados en la sesión\n";
-    std::cout << "  alias name='cmd' : crear alias simple (sin persistencia)\n";
-    std::cout << "  parallel cmd1 ;; cmd2 ;; ... : ejecutar comandos en paralelo (separador ';;')\n";
+    std::cout << "  history [-n N | -s texto | -p prefijo] : historial persistente (últimas N, subcadena, prefijo)\n";
+    std::cout << "  alias name='cmd' : crear alias (se expande recursivamente al definirlo; $(...), $? y comodines al usarlo)\n";
+    std::cout << "  parallel [-j N] cmd1 ;; cmd2 ;; ... : ejecutar comandos en paralelo, como máximo N a la vez\n";
+    std::cout << "      --pin (un CPU por hijo), --cpus 0-3,8, --reserve (un CPU para la shell), --nice N, --ionice idle|be[:N]|rt[:N]\n";
+    std::cout << "  pmap [-j N] [-c] cmd {} < lista : ejecuta cmd por cada línea de la lista, salida en orden (-c: al terminar);\n";
+    std::cout << "      admite las mismas opciones de colocación que parallel\n";
+    std::cout << "  jobs             : lista los trabajos en segundo plano\n";
+    std::cout << "  wait [id]        : espera a un trabajo (o a todos) sin sondear\n";
+    std::cout << "  fg [id]          : espera en primer plano al trabajo (por defecto, el más reciente)\n";
+    std::cout << "  time [cmd]       : ejecuta cmd y muestra tiempo real, CPU, maxrss, fallos de página y cambios de contexto (solo: el último comando)\n";
+    std::cout << "  stats [on|off|reset] : agregados por comando (p50/p99, CPU total); sin argumento los muestra\n";
+    std::cout << "  trace on [archivo] | off : línea de tiempo (JSON de Chrome trace, para Perfetto) de las fases de la shell y de los hijos\n";
     std::cout << "  meminfo          : muestra uso aproximado de memoria (VmSize, VmRSS, VmData)\n";
+    std::cout << "  cpuinfo          : CPUs, afinidad, nice e ionice de la shell y reparto del último parallel/pmap\n";
+    std::cout << "  hash [-r] [cmd...]: lista, limpia (-r) o precarga la tabla de rutas de PATH\n";
+    std::cout << "  pipesize [bytes] : muestra o fija la capacidad de los pipes (F_SETPIPE_SZ, 0 = por defecto)\n";
     std::cout << "  help             : esta ayuda\n";
+    std::cout << "Los built-ins admiten <, > y >> y pueden formar parte de una tubería (history | grep x).\n";
+    std::cout << "Varias salidas (cmd > a >> b | sig) reciben todas la misma copia (tee/splice en la shell; '>>' añade con read/write).\n";
+    std::cout << "$(cmd) se sustituye por la salida de cmd (dividida en palabras fuera de comillas).\n";
+    std::cout << "Listas: a ; b (en secuencia), a && b (b si a sale con 0), a || b (b si a falla); $? es el último estado.\n";
+    std::cout << "Los comodines *, ? y [...] fuera de comillas se sustituyen por los archivos que coinciden, en orden.\n";
+}
+
+static int builtin_salir(const std::vector<std::string>&) {
+    std::cout.flush();
+    if (forked_child) _exit(0); // Una etapa de tubería: termina solo el hijo, sin los atexit de la shell
+    exit(0); // Termina la shell
+}
+
+static int builtin_pwd(const std::vector<std::string>&) {
+    char buf[4096];
+    if (!getcwd(buf, sizeof(buf))) { perror("pwd"); return 1; }
+    std::cout << buf << "\n"; // Muestra directorio actual
+    return 0;
+}
+
+static int builtin_cd(const std::vector<std::string> &tokens) {
+    std::string dir = (tokens.size()>=2 ? tokens[1] : getenv("HOME") ? getenv("HOME") : "/"); // Determina el directorio
+    if (chdir(dir.c_str()) != 0) { perror(("cd: "+dir).c_str()); return 1; } // Cambia el directorio
+    return 0;
+}
+
+static int builtin_help(const std::vector<std::string>&) {
+    print_help();
+    return 0;
+}
+
+static int builtin_history(const std::vector<std::string> &tokens) {
+    if (tokens.size()==1) { history_print_last(0); return 0; } // Imprime el historial
+    if (tokens.size()==3 && tokens[1]=="-n") { history_print_last(strtoul(tokens[2].c_str(), nullptr, 10)); return 0; }
+    if (tokens.size()==3 && tokens[1]=="-s") { history_search(tokens[2], false); return 0; }
+    if (tokens.size()==3 && tokens[1]=="-p") { history_search(tokens[2], true); return 0; }
+    std::cerr << "Uso: history [-n N | -s texto | -p prefijo]\n";
+    return 2;
+}
+
+static int builtin_alias(const std::vector<std::string> &tokens) {
+    if (tokens.size()==1) {
+        for (auto &p: *alias_snapshot())
+            std::cout << p.first << "='" << p.second.text << "'\n"; // Lista aliases
+        return 0;
+    }
+    // Lógica para crear un alias
+    std::string rest;
+    for (size_t i=1;i<tokens.size();++i) {
+        if (i>1) rest += " ";
+        rest += tokens[i];
+    }
+    auto eq = rest.find('=');
+    if (eq==std::string::npos) { std::cerr << "alias: formato inválido\n"; return 1; }
+    std::string name = trim(rest.substr(0, eq));
+    std::string val = rest.substr(eq+1);
+    if (!val.empty() && val.front()=='\'') val.erase(0,1);
+    if (!val.empty() && val.back()=='\'') val.pop_back();
+    if (name.empty() || val.empty()) { std::cerr << "alias: formato inválido\n"; return 1; }
+    return define_alias(name, val) ? 0 : 1; // Almacena el alias
+}
+
+static int builtin_meminfo(const std::vector<std::string>&) {
+    // leer /proc/self/status y mostrar VmSize, VmRSS, VmData (aprox)
+    std::ifstream f("/proc/self/status"); // Abre el archivo de estado del proceso
+    if (!f) { perror("meminfo: /proc/self/status"); return 1; }
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.rfind("VmSize:",0)==0 || line.rfind("VmRSS:",0)==0 || line.rfind("VmData:",0)==0) {
+            std::cout << line << "\n"; // Muestra información de memoria
+        }
+    }
+    return 0;
+}
+
+static int builtin_cpuinfo(const std::vector<std::string>&) {
+    placement_print(); // Afinidad, nice e ionice de la shell y reparto del último parallel/pmap
+    return 0;
+}
+
+static int builtin_hash(const std::vector<std::string> &tokens) {
+    if (tokens.size()==1) {
+        path_cache_print(); // Lista la tabla de rutas
+    } else if (tokens[1]=="-r") {
+        path_cache_clear(); // Vacía la tabla
+    } else {
+        int status = 0;
+        for (size_t i=1;i<tokens.size();++i)
+            if (!path_cache_warm(tokens[i])) { std::cerr << "hash: " << tokens[i] << ": no encontrado\n"; status = 1; } // Precarga
+        return status;
+    }
+    return 0;
+}
+
+static int builtin_pipesize(const std::vector<std::string> &tokens) {
+    if (tokens.size()==1) {
+        if (pipe_buffer_size > 0) std::cout << pipe_buffer_size << "\n";
+        else std::cout << "por defecto\n";
+        return 0;
+    }
+    char *end = nullptr;
+    long n = strtol(tokens[1].c_str(), &end, 10);
+    if (end == tokens[1].c_str() || *end != '\0' || n < 0 || n > INT_MAX) {
+        std::cerr << "pipesize: tamaño inválido (0 a " << INT_MAX << " bytes)\n";
+        return 1;
+    }
+    pipe_buffer_size = static_cast<int>(n); // Se aplica a los pipes creados desde ahora
+    return 0;
+}
+
+static int builtin_pmap(const std::vector<std::string> &tokens) {
+    return run_pmap(tokens); // Lee la lista en streaming y reparte las entradas entre N hijos
+}
+
+static int builtin_jobs(const std::vector<std::string>&) {
+    jobs_print();
+    return 0;
+}
+
+static int builtin_wait(const std::vector<std::string> &tokens) {
+    return job_wait(tokens.size()>=2 ? atoi(tokens[1].c_str()) : -1); // Bloquea hasta que el recolector lo recoja
+}
+
+static int builtin_fg(const std::vector<std::string> &tokens) {
+    int id = (tokens.size()>=2 ? atoi(tokens[1].c_str()) : job_last_id());
+    std::string cmdline = job_command(id);
+    if (cmdline.empty()) { std::cerr << "fg: no existe el trabajo\n"; return 1; }
+    std::cout << cmdline << "\n";
+    return job_wait(id);
+}
+
+static int builtin_stats(const std::vector<std::string> &tokens) {
+    if (tokens.size()==1) stats_print();
+    else if (tokens[1]=="on") stats_enabled = true;
+    else if (tokens[1]=="off") stats_enabled = false;
+    else if (tokens[1]=="reset") stats_reset();
+    else { std::cerr << "Uso: stats [on|off|reset]\n"; return 2; }
+    return 0;
+}
+
+static int builtin_trace(const std::vector<std::string> &tokens) {
+    if (tokens.size()==1) {
+        if (trace_enabled) std::cout << "trace: activo (" << trace_file() << ")\n";
+        else std::cout << "trace: inactivo\n";
+        return 0;
+    }
+    if (tokens[1]=="on") {
+        if (trace_enabled) { std::cerr << "trace: ya está activo\n"; return 1; }
+        return trace_start(tokens.size()>=3 ? tokens[2] : "mini_shell_trace.json") ? 0 : 1;
+    }
+    if (tokens[1]=="off") {
+        if (!trace_enabled) { std::cerr << "trace: no está activo\n"; return 1; }
+        return trace_stop() ? 0 : 1;
+    }
+    std::cerr << "Uso: trace on [archivo] | trace off\n";
+    return 2;
+}
+
+// 'time cmd' al principio de una línea lo intercepta run_line (mide la línea entera); aquí llegan
+// los demás: una etapa de tubería, un alias de time o un comando de parallel. Las redirecciones ya
+// se quitaron, así que todas las palabras son argumentos.
+static int builtin_time(const std::vector<std::string> &tokens) {
+    if (tokens.size() == 1) { print_usage(last_usage); return 0; } // 'time' solo: el último comando
+    std::vector<std::string> cmd(tokens.begin()+1, tokens.end());
+    UsageTimer timer;
+    usage_timer_start(timer);
+    int status = execute_command_simple(cmd, false, std::vector<bool>(cmd.size(), true));
+    print_usage(usage_timer_stop(timer));
+    return status;
+}
+
+static int builtin_parallel(const std::vector<std::string>&) {
+    // no debería llegar aquí normalmente porque el servidor principal se enrutará; pero admite respaldo
+    std::cerr << "Uso: parallel [-j N] cmd1 ;; cmd2 ;; cmd3 ...\n";
+    return 2;
+}
+
+// Registro de built-ins: una búsqueda en tabla en vez de cadenas de comparaciones
+static const std::unordered_map<std::string, BuiltinFn> builtin_registry = {
+    {"salir", builtin_salir}, {"cd", builtin_cd}, {"pwd", builtin_pwd}, {"help", builtin_help},
+    {"history", builtin_history}, {"alias", builtin_alias}, {"parallel", builtin_parallel},
+    {"meminfo", builtin_meminfo}, {"cpuinfo", builtin_cpuinfo}, {"hash", builtin_hash}, {"pipesize", builtin_pipesize},
+    {"pmap", builtin_pmap}, {"jobs", builtin_jobs}, {"wait", builtin_wait}, {"fg", builtin_fg},
+    {"time", builtin_time}, {"stats", builtin_stats}, {"trace", builtin_trace},
+};
+
+// Comprueba si el comando es un built-in
+bool is_builtin(const std::string &cmd) {
+    return builtin_registry.find(cmd) != builtin_registry.end();
+}
+
+// Ejecuta la lógica del comando built-in y devuelve su código de salida
+int handle_builtin(const std::vector<std::string>& tokens) {
+    if (tokens.empty()) return 0;
+    auto it = builtin_registry.find(tokens[0]);
+    if (it == builtin_registry.end()) return 127;
+    return it->second(tokens);
+}
+
+std::shared_ptr<const AliasMap> alias_snapshot() {
+    return std::atomic_load(&alias_table);
+}
+
+// Divide el valor de un alias sin ejecutar nada: las palabras fijas se tokenizan ya; las que
+// llevan $(...), $? o comodines quedan como texto para tokenizarlas en cada uso
+static bool split_alias_value(const std::string &text, std::vector<std::string> &out,
+                              std::vector<bool> &literal, std::vector<bool> &dynamic) {
+    std::vector<std::string> raw;
+    std::vector<bool> raw_dynamic;
+    out.clear(); literal.clear(); dynamic.clear();
+    if (!split_raw_words(text, raw, raw_dynamic)) return false;
+    for (size_t k=0;k<raw.size();++k) {
+        if (raw_dynamic[k]) {
+            out.push_back(std::move(raw[k]));
+            literal.push_back(false);
+            dynamic.push_back(true);
+            continue;
+        }
+        std::vector<bool> lit;
+        for (auto &w: tokenize(raw[k], false, &lit)) out.push_back(std::move(w));
+        literal.insert(literal.end(), lit.begin(), lit.end());
+        dynamic.resize(out.size(), false);
+    }
+    return true;
 }
 
-// Ejecuta la lógica del comando built-in
-void handle_builtin(const std::vector<std::string>& tokens) {
-    if (tokens.empty()) return;
-    std::string cmd = tokens[0];
-    if (cmd=="salir") {
-        exit(0); // Termina la shell
-    } else if (cmd=="pwd") {
-        char buf[4096];
-        if (getcwd(buf, sizeof(buf))) std::cout << buf << "\n"; // Muestra directorio actual
-        else perror("pwd");
-    } else if (cmd=="cd") {
-        std::string dir = (tokens.size()>=2 ? tokens[1] : getenv("HOME") ? getenv("HOME") : "/"); // Determina el directorio
-        if (chdir(dir.c_str()) != 0) perror(("cd: "+dir).c_str()); // Cambia el directorio
-    } else if (cmd=="help") {
-        print_help();
-    } else if (cmd=="history") {
-        std::lock_guard<std::mutex> lk(builtins_mutex); // Bloquea para acceder a history
-        for (size_t i=0;i<history_list.size();++i)
-            std::cout << std::setw(4) << i+1 << "  " << history_list[i] << "\n"; // Imprime el historial
-    } else if (cmd=="alias") {
-        std::lock_guard<std::mutex> lk(builtins_mutex); // Bloquea para acceder a aliases
-        if (tokens.size()==1) {
-            for (auto &p: aliases)
-                std::cout << p.first << "='" << p.second << "'\n"; // Lista aliases
-        } else {
-            // Lógica para crear un alias
-            std::string rest;
-            for (size_t i=1;i<tokens.size();++i) {
-                if (i>1) rest += " ";
-                rest += tokens[i];
-            }
-            auto eq = rest.find('=');
-            if (eq==std::string::npos) { std::cerr << "alias: formato inválido\n"; return; }
-            std::string name = trim(rest.substr(0, eq));
-            std::string val = rest.substr(eq+1);
-            if (!val.empty() && val.front()=='\'') val.erase(0,1);
-            if (!val.empty() && val.back()=='\'') val.pop_back();
-            if (name.empty() || val.empty()) { std::cerr << "alias: formato inválido\n"; return; }
-            aliases[name] = val; // Almacena el alias
+// Expande recursivamente la cabeza del alias name. Un alias que empieza por su propio nombre
+// (alias ls='ls -l') no se vuelve a expandir; volver a un alias de la cadena es un ciclo.
+// Una cabeza dinámica ($(...), comodines) no se busca como alias: su valor se conoce al usarlo.
+static bool expand_alias(AliasMap &table, const std::string &name, std::vector<std::string> &chain,
+                         std::vector<std::string> &out, std::vector<bool> &literal, std::vector<bool> &dynamic) {
+    if (!split_alias_value(table[name].text, out, literal, dynamic)) return false;
+    if (out.empty() || out[0] == name || dynamic[0]) return true;
+    auto it = table.find(out[0]);
+    if (it == table.end()) return true; // La cabeza no es un alias
+    chain.push_back(name);
+    for (auto &c: chain) {
+        if (c == out[0]) {
+            std::cerr << "alias: ciclo detectado (";
+            for (auto &n: chain) std::cerr << n << " -> ";
+            std::cerr << out[0] << ")\n";
+            return false;
         }
-    } else if (cmd=="meminfo") {
-        // leer /proc/self/status y mostrar VmSize, VmRSS, VmData (aprox)
-        std::ifstream f("/proc/self/status"); // Abre el archivo de estado del proceso
-        if (!f) { perror("meminfo: /proc/self/status"); return; }
-        std::string line;
-        while (std::getline(f, line)) {
-            if (line.rfind("VmSize:",0)==0 || line.rfind("VmRSS:",0)==0 || line.rfind("VmData:",0)==0) {
-                std::cout << line << "\n"; // Muestra información de memoria
-            }
+    }
+    std::vector<std::string> head;
+    std::vector<bool> head_literal, head_dynamic;
+    bool ok = expand_alias(table, out[0], chain, head, head_literal, head_dynamic);
+    chain.pop_back();
+    if (!ok) return false;
+    head.insert(head.end(), out.begin()+1, out.end()); // Argumentos del alias tras la expansión de la cabeza
+    head_literal.insert(head_literal.end(), literal.begin()+1, literal.end());
+    head_dynamic.insert(head_dynamic.end(), dynamic.begin()+1, dynamic.end());
+    out.swap(head);
+    literal.swap(head_literal);
+    dynamic.swap(head_dynamic);
+    return true;
+}
+
+// Copia la tabla, añade el alias, recalcula todas las expansiones y publica la nueva versión.
+// Los lectores que ya tenían la versión anterior la siguen usando hasta soltar su shared_ptr.
+// Recalcular no ejecuta nada: los $(...) de los valores esperan al uso del alias.
+bool define_alias(const std::string &name, const std::string &value) {
+    std::lock_guard<std::mutex> lk(builtins_mutex); // Un escritor a la vez
+    auto next = std::make_shared<AliasMap>(*alias_snapshot());
+    (*next)[name].text = value;
+    for (auto &p: *next) {
+        std::vector<std::string> chain;
+        std::vector<std::string> words;
+        std::vector<bool> literal, dynamic;
+        if (!expand_alias(*next, p.first, chain, words, literal, dynamic)) return false; // Se descarta la nueva tabla
+        p.second.words.swap(words);
+        p.second.literal.swap(literal);
+        p.second.has_dynamic = std::find(dynamic.begin(), dynamic.end(), true) != dynamic.end();
+        p.second.dynamic.swap(dynamic);
+    }
+    std::atomic_store(&alias_table, std::shared_ptr<const AliasMap>(std::move(next)));
+    return true;
+}
+
+// Tokeniza ahora las palabras dinámicas del alias ($(...), $?, comodines); las fijas se copian
+static void expand_dynamic_words(const AliasEntry &a, std::vector<std::string> &out, std::vector<bool> &literal) {
+    TokenArena arena; // Propio: una $(...) puede volver a pasar por resolve_alias
+    for (size_t k=0;k<a.words.size();++k) {
+        if (!a.dynamic[k]) {
+            out.push_back(a.words[k]);
+            literal.push_back(a.literal[k]);
+            continue;
         }
-    } else if (cmd=="parallel") {
-        // no debería llegar aquí normalmente porque el servidor principal se enrutará; pero admite respaldo
-        std::cerr << "Uso: parallel cmd1 ;; cmd2 ;; cmd3 ...\n";
+        if (!tokenize_into(a.words[k], arena)) continue; // El error ya se informó; la palabra se pierde
+        out.insert(out.end(), arena.words.begin(), arena.words.end());
+        literal.insert(literal.end(), arena.literal.begin(), arena.literal.end());
     }
 }
 
-// Definición de resolve_alias: expande aliases correctamente
-bool resolve_alias(std::vector<std::string> &tokens) {
+// Definición de resolve_alias: sustituye tokens[0] por su expansión ya tokenizada (sin bloquear)
+bool resolve_alias(std::vector<std::string> &tokens, std::vector<bool> *literal) {
     if (tokens.empty()) return false;
-    auto it = aliases.find(tokens[0]);
-    if (it == aliases.end()) return false; // No hay alias
-    // tokenizar el valor del alias y reemplazar tokens[0] por los tokens del alias
-    std::vector<std::string> ali_tok = tokenize(it->second); // Tokeniza el valor del alias
+    TraceScope span("resolve_alias");
+    std::shared_ptr<const AliasMap> snap = alias_snapshot();
+    if (snap->empty()) return false;
+    auto it = snap->find(tokens[0]);
+    if (it == snap->end()) return false; // No hay alias
     std::vector<std::string> newt;
-    newt.insert(newt.end(), ali_tok.begin(), ali_tok.end()); // Inserta el alias expandido
-    if (tokens.size() > 1)
-        newt.insert(newt.end(), tokens.begin()+1, tokens.end()); // Añade argumentos originales
+    std::vector<bool> alias_literal;
+    if (it->second.has_dynamic) {
+        expand_dynamic_words(it->second, newt, alias_literal);
+    } else {
+        const std::vector<std::string> &words = it->second.words;
+        newt.reserve(words.size() + tokens.size() - 1);
+        newt.insert(newt.end(), words.begin(), words.end()); // Inserta el alias expandido
+        if (literal) alias_literal = it->second.literal;
+    }
+    newt.insert(newt.end(), std::make_move_iterator(tokens.begin()+1), std::make_move_iterator(tokens.end())); // Añade argumentos originales
     tokens.swap(newt); // Reemplaza la lista de tokens
+    if (literal) {
+        std::vector<bool> newl(std::move(alias_literal));
+        if (literal->size() > 1) newl.insert(newl.end(), literal->begin()+1, literal->end());
+        newl.resize(tokens.size(), false);
+        literal->swap(newl);
+    }
     return true;
 }
 
-// Trabajador de subprocesos en paralelo: el argumento es un puntero a un std::string* asignado al montón
-static void* parallel_thread_func(void* arg) {
-    std::string* s = static_cast<std::string*>(arg);
-    std::string cmdline = *s;
-    delete s; // Libera el heap
-    // tokenizar y ejecutar a través del ejecutor (en primer plano dentro del hilo)
-    std::vector<std::string> tokens = tokenize(cmdline);
-    if (!tokens.empty()) {
-        // fuerza el fondo a falso para que el hilo principal pueda continuar
-        execute_command_simple(tokens, false); // Ejecuta el comando en el hilo
+// Se espera el resto: texto completo después de "parallel" (opciones "-j N", "--pin", "--cpus L",
+// "--reserve", "--nice N", "--ionice C"); comandos separados por ";;"
+int run_parallel_from_line(const std::string &rest) {
+    int max_jobs = 0; // Por defecto, una plaza por CPU disponible para los hijos
+    Placement placement;
+    std::string line = rest;
+    // Las opciones son palabras sin comillas al principio: se consumen del texto una a una
+    while (line.rfind("-", 0) == 0) {
+        std::vector<std::string> words;
+        size_t pos = 0;
+        for (int k=0;k<2 && pos<line.size();++k) { // La opción y su posible argumento
+            size_t sp = line.find_first_of(" \t", pos);
+            if (sp == std::string::npos) sp = line.size();
+            words.push_back(line.substr(pos, sp - pos));
+            pos = line.find_first_not_of(" \t", sp);
+            if (pos == std::string::npos) pos = line.size();
+        }
+        int used = placement_option(words, 0, placement);
+        if (used < 0) return 2;
+        if (used == 0 && words[0] == "-j" && words.size() == 2 && atoi(words[1].c_str()) >= 1) {
+            max_jobs = atoi(words[1].c_str());
+            used = 2;
+        }
+        if (used == 0) { std::cerr << "Uso: parallel [-j N] [--pin] [--cpus L] [--reserve] [--nice N] [--ionice C] cmd1 ;; cmd2 ;; ...\n"; return 2; }
+        line = used == 1 ? trim(line.substr(words[0].size())) : trim(line.substr(pos));
     }
-    return nullptr;
-}
-
-// Se espera el resto: texto completo después de "paralelo"; comandos separados por ";;"
-void run_parallel_from_line(const std::string &rest) {
     // dividido por ";;"
     std::vector<std::string> cmds;
     size_t pos = 0;
-    while (pos < rest.size()) {
-        size_t p = rest.find(";;", pos); // Busca el separador
-        if (p==std::string::npos) p = rest.size();
-        std::string part = trim(rest.substr(pos, p-pos)); // Extrae el comando
+    while (pos < line.size()) {
+        size_t p = line.find(";;", pos); // Busca el separador
+        if (p==std::string::npos) p = line.size();
+        std::string part = trim(line.substr(pos, p-pos)); // Extrae el comando
         if (!part.empty()) cmds.push_back(part);
         pos = p + 2;
     }
-    if (cmds.empty()) { std::cerr << "parallel: no hay comandos\n"; return; }
-    std::vector<pthread_t> threads(cmds.size());
-    for (size_t i=0;i<cmds.size();++i) {
-        // asignar cadena en el montón para el hilo
-        std::string *arg = new std::string(cmds[i]); // Asigna memoria para el argumento del hilo
-        if (pthread_create(&threads[i], nullptr, &parallel_thread_func, arg) != 0) {
-            perror("pthread_create");
-            delete arg;
-        }
-    }
-    // unir hilos
-    for (size_t i=0;i<threads.size();++i) pthread_join(threads[i], nullptr); // Espera a que todos terminen
+    if (cmds.empty()) { std::cerr << "parallel: no hay comandos\n"; return 2; }
+    int failures = run_bounded(cmds, max_jobs, placement); // Un solo hilo, como máximo max_jobs hijos
+    std::cout << "parallel: " << cmds.size() << " comandos, " << failures << " fallidos\n";
+    return failures > 0 ? 1 : 0;
 }
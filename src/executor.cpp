@@ -2,170 +2,430 @@
 #include "builtins.hpp"
 #include "parser.hpp"
 #include "signals.hpp"
+#include "pathcache.hpp"
+#include "accounting.hpp"
+#include "trace.hpp"
+#include "relay.hpp"
 #include <iostream>
-#include <unistd.h>     // fork, exec, access, dup2, pipe
+#include <unistd.h>     // access, close, pipe2
 #include <fcntl.h>      // open flags
-#include <sys/wait.h>   // waitpid
+#include <spawn.h>      // posix_spawn
+#include <sys/wait.h>   // wait4
+#include <sys/resource.h> // struct rusage
+#include <chrono>
 #include <errno.h>
 #include <vector>
 #include <cstring>
+#include <cstdlib>      // realloc
+#include <algorithm>    // std::max
+
+extern char **environ;
+
+int pipe_buffer_size = 0;
 
 // Comprueba si la ruta es accesible y ejecutable (X_OK)
 bool file_exists_and_executable(const std::string &path) {
     return (access(path.c_str(), X_OK) == 0);
 }
 
-// Resuelve la ruta del comando buscando en /bin/ y /usr/bin/ si no contiene '/'
+// Resuelve la ruta del comando con la tabla de PATH del padre si no contiene '/'
 std::string resolve_command_path(const std::string &cmd) {
     if (cmd.find('/') != std::string::npos) return cmd;
-    std::string candidate = std::string("/bin/") + cmd;
-    if (file_exists_and_executable(candidate)) return candidate;
-    candidate = std::string("/usr/bin/") + cmd;
-    if (file_exists_and_executable(candidate)) return candidate;
-    return cmd; // Dejar que execvp lo resuelva con PATH
+    TraceScope span("resolve_command_path");
+    std::string path = path_cache_lookup(cmd);
+    return path.empty() ? cmd : path; // Sin '/' significa que no está en PATH
 }
 
-// Ejecuta un comando simple (sin pipe), manejando alias, built-ins y redirecciones
-void execute_command_simple(std::vector<std::string> tokens, bool background) {
-    if (tokens.empty()) return;
-    resolve_alias(tokens); // Expande alias
-    if (tokens.empty()) return;
+static double elapsed_ms(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
 
-    if (is_builtin(tokens[0])) {
-        handle_builtin(tokens); // Ejecuta built-in en la shell
-        return;
+// Texto de un comando para la tabla de trabajos
+static std::string join_words(const std::vector<std::string> &words) {
+    std::string out;
+    for (size_t i=0;i<words.size();++i) {
+        if (i) out += " ";
+        out += words[i];
     }
+    return out;
+}
 
-    std::string infile = "", outfile = "";
-    bool append = false;
-    std::vector<std::string> argv_tokens;
-
-    // Procesa tokens y extrae las redirecciones (<, >, >>)
+// Procesa tokens y extrae las redirecciones (<, >, >>)
+bool split_redirections(const std::vector<std::string> &tokens, std::vector<std::string> &argv_tokens, Redirections &redir,
+                        const std::vector<bool> &literal) {
     for (size_t i=0; i<tokens.size(); ++i) {
-        if (tokens[i] == "<") {
-            if (i+1 < tokens.size()) { infile = tokens[i+1]; ++i; }
-            else { std::cerr << "Error: '<' sin archivo\n"; return; }
+        if (i < literal.size() && literal[i]) argv_tokens.push_back(tokens[i]); // Entre comillas: argumento
+        else if (tokens[i] == "<") {
+            if (i+1 < tokens.size()) { redir.infile = tokens[i+1]; ++i; }
+            else { std::cerr << "Error: '<' sin archivo\n"; return false; }
         }
         else if (tokens[i] == ">") {
-            if (i+1 < tokens.size()) { outfile = tokens[i+1]; append = false; ++i; }
-            else { std::cerr << "Error: '>' sin archivo\n"; return; }
+            if (i+1 < tokens.size()) { redir.outputs.push_back({tokens[i+1], false}); ++i; }
+            else { std::cerr << "Error: '>' sin archivo\n"; return false; }
         }
         else if (tokens[i] == ">>") {
-            if (i+1 < tokens.size()) { outfile = tokens[i+1]; append = true; ++i; }
-            else { std::cerr << "Error: '>>' sin archivo\n"; return; }
+            if (i+1 < tokens.size()) { redir.outputs.push_back({tokens[i+1], true}); ++i; }
+            else { std::cerr << "Error: '>>' sin archivo\n"; return false; }
         }
         else argv_tokens.push_back(tokens[i]); // Argumento de comando
     }
+    return true;
+}
+
+// Abre un destino de salida. '>>' mantiene O_APPEND también con el repartidor: cada escritura va
+// al final aunque otro proceso escriba en el mismo archivo.
+static int open_output(const OutputTarget &out) {
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (out.append ? O_APPEND : O_TRUNC);
+    int fd = open(out.path.c_str(), flags, 0644);
+    if (fd < 0) { perror((std::string("open ")+out.path).c_str()); return -1; }
+    return fd;
+}
+
+// Abre los archivos de redirección (O_CLOEXEC); -1 si no hay. false si alguno falla.
+// downstream es el pipe hacia la etapa siguiente (-1 si no hay): con destinos de salida también
+// recibe los datos, y rout pasa a ser la entrada de un repartidor.
+static bool open_redirections(const Redirections &redir, int &rin, int &rout, int downstream) {
+    rin = rout = -1;
+    if (!redir.infile.empty()) {
+        // Maneja redirección de entrada
+        rin = open(redir.infile.c_str(), O_RDONLY | O_CLOEXEC);
+        if (rin < 0) { perror((std::string("open ")+redir.infile).c_str()); return false; }
+    }
+    if (redir.outputs.empty()) return true;
+    if (redir.outputs.size() == 1 && downstream < 0) {
+        // Maneja redirección de salida (TRUNC/APPEND)
+        rout = open_output(redir.outputs[0]);
+    } else {
+        std::vector<int> sinks;
+        for (auto &out: redir.outputs) {
+            int fd = open_output(out);
+            if (fd < 0) break;
+            sinks.push_back(fd);
+        }
+        if (sinks.size() == redir.outputs.size()) {
+            if (downstream >= 0) sinks.push_back(fcntl(downstream, F_DUPFD_CLOEXEC, 0));
+            rout = relay_start(sinks); // Se queda con los sinks
+        } else {
+            for (int fd: sinks) close(fd);
+        }
+    }
+    if (rout < 0) {
+        if (rin >= 0) close(rin);
+        rin = -1;
+        return false;
+    }
+    return true;
+}
+
+// Ejecuta un built-in dentro de la shell con redirección temporal de STDIN/STDOUT:
+// se guardan los descriptores originales, se hace dup2 y se restauran al terminar
+static int run_builtin_fds(const std::vector<std::string> &argv_tokens, const Redirections &redir, int in_fd, int out_fd) {
+    int rin, rout;
+    if (!open_redirections(redir, rin, rout, out_fd)) return 1;
+    if (rin >= 0) in_fd = rin;
+    if (rout >= 0) out_fd = rout;
+
+    std::cout.flush(); // Lo pendiente va al stdout original
+    bool swap_in = (in_fd >= 0 && in_fd != STDIN_FILENO);
+    bool swap_out = (out_fd >= 0 && out_fd != STDOUT_FILENO);
+    int saved_in = swap_in ? fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10) : -1;
+    int saved_out = swap_out ? fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10) : -1;
+    if (swap_in) dup2(in_fd, STDIN_FILENO);
+    if (swap_out) dup2(out_fd, STDOUT_FILENO);
+
+    int status = handle_builtin(argv_tokens);
+
+    std::cout.flush(); // Lo escrito por el built-in va al destino redirigido
+    if (swap_out) {
+        if (saved_out >= 0) { dup2(saved_out, STDOUT_FILENO); close(saved_out); }
+        else close(STDOUT_FILENO); // Estaba cerrado antes de redirigir
+    }
+    if (swap_in) {
+        if (saved_in >= 0) { dup2(saved_in, STDIN_FILENO); close(saved_in); }
+        else close(STDIN_FILENO);
+    }
+    if (rin >= 0) close(rin);
+    if (rout >= 0) close(rout); // EOF para el repartidor, si lo hay
+    return status;
+}
+
+// Respaldo con fork: posix_spawn solo puede ejecutar un programa, así que un built-in que no es
+// la última etapa de una tubería necesita su propio proceso. close_fd es el extremo de lectura del
+// pipe siguiente, que el hijo no debe conservar (sin exec, O_CLOEXEC no lo cierra).
+static pid_t fork_builtin(const std::vector<std::string> &argv_tokens, const Redirections &redir, int in_fd, int out_fd, int close_fd) {
+    pid_t pid = fork_child(); // SIGINT por defecto y la tabla de trabajos a salvo del recolector
+    if (pid < 0) { perror("fork"); return -1; }
+    if (pid == 0) { // Código del hijo
+        if (close_fd >= 0) close(close_fd);
+        int status = run_builtin_fds(argv_tokens, redir, in_fd, out_fd);
+        std::cout.flush();
+        relay_join_pending(); // El repartidor es un hilo de este proceso
+        _exit(status);
+    }
+    trace_child_start(pid, argv_tokens[0].c_str());
+    return pid;
+}
+
+// Built-in con sus redirecciones (<, >, >>), ejecutado en la shell
+int run_builtin(const std::vector<std::string> &tokens, const std::vector<bool> &literal) {
+    Redirections redir;
+    std::vector<std::string> argv_tokens;
+    if (!split_redirections(tokens, argv_tokens, redir, literal)) return 2;
+    return run_builtin_fds(argv_tokens, redir, -1, -1);
+}
 
+// Lanza un proceso hijo con posix_spawn. glibc lo implementa con clone(CLONE_VM|CLONE_VFORK),
+// así que el coste no depende del tamaño de la shell (no se copian tablas de páginas).
+// Las redirecciones se abren en el padre (para informar errores con el nombre del archivo)
+// y se expresan como acciones dup2; los pipes deben crearse con O_CLOEXEC.
+pid_t spawn_argv(char *const argv[], const Redirections &redir, int in_fd, int out_fd) {
+    if (!argv || !argv[0]) return -1;
+    const std::string cmd = argv[0];
+
+    int rin = -1, rout = -1;
+    if (!open_redirections(redir, rin, rout, out_fd)) return -1;
+    if (rin >= 0) in_fd = rin;
+    if (rout >= 0) out_fd = rout;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd >= 0 && in_fd != STDIN_FILENO) posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO); // Redirige STDIN
+    if (out_fd >= 0 && out_fd != STDOUT_FILENO) posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO); // Redirige STDOUT
+
+    // Restaura SIGINT a SIG_DFL y limpia la máscara de señales en el hijo
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t sig_default, sig_mask;
+    sigemptyset(&sig_default); sigaddset(&sig_default, SIGINT);
+    sigemptyset(&sig_mask);
+    posix_spawnattr_setsigdefault(&attr, &sig_default);
+    posix_spawnattr_setsigmask(&attr, &sig_mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    // La salida pendiente de la shell debe salir antes que la del hijo (stdout no es una terminal en modo batch)
+    std::cout.flush();
+
+    // El hijo solo hace un execv directo: la búsqueda en PATH ya se hizo en el padre
+    pid_t pid = -1;
+    std::string cmd_path = resolve_command_path(cmd);
+    if (cmd_path.find('/') == std::string::npos) {
+        std::cerr << cmd_path << ": comando no encontrado\n";
+    } else {
+        TraceScope span("spawn"); // clone + exec del hijo (posix_spawn vuelve tras el exec)
+        int rc = posix_spawn(&pid, cmd_path.c_str(), &actions, &attr, argv, environ);
+        if (rc == ENOENT && cmd.find('/') == std::string::npos) {
+            // La entrada de la tabla quedó obsoleta (ejecutable borrado): se busca de nuevo una vez
+            path_cache_forget(cmd);
+            cmd_path = resolve_command_path(cmd);
+            if (cmd_path.find('/') != std::string::npos)
+                rc = posix_spawn(&pid, cmd_path.c_str(), &actions, &attr, argv, environ);
+        }
+        if (rc != 0) {
+            std::cerr << "exec " << cmd_path << ": " << strerror(rc) << "\n";
+            pid = -1;
+        } else {
+            trace_child_start(pid, cmd.c_str(), span.start);
+        }
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rin >= 0) close(rin);
+    if (rout >= 0) close(rout);
+    return pid;
+}
+
+pid_t spawn_command(const std::vector<std::string> &argv_tokens, const Redirections &redir, int in_fd, int out_fd) {
+    if (argv_tokens.empty()) return -1;
     // Prepara el array de argumentos en formato C (char* array terminado en nullptr)
     std::vector<char*> argv;
     for (auto &s: argv_tokens) argv.push_back(const_cast<char*>(s.c_str()));
     argv.push_back(nullptr);
+    return spawn_argv(argv.data(), redir, in_fd, out_fd);
+}
 
-    pid_t pid = fork(); // Crea proceso hijo
-    if (pid < 0) {
-        perror("fork");
-        return;
-    } else if (pid == 0) { // Código del hijo
-        // Restaura el manejador de SIGINT a por defecto (SIG_DFL)
-        struct sigaction sa_default; sa_default.sa_handler = SIG_DFL;
-        sigemptyset(&sa_default.sa_mask); sa_default.sa_flags = 0;
-        sigaction(SIGINT, &sa_default, nullptr);
-
-        if (!infile.empty()) {
-            // Maneja redirección de entrada
-            int fd = open(infile.c_str(), O_RDONLY);
-            if (fd < 0) { perror((std::string("open ")+infile).c_str()); _exit(1); }
-            dup2(fd, STDIN_FILENO); // Redirige STDIN
-            close(fd);
-        }
-        if (!outfile.empty()) {
-            // Maneja redirección de salida (TRUNC/APPEND)
-            int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
-            int fd = open(outfile.c_str(), flags, 0644);
-            if (fd < 0) { perror((std::string("open ")+outfile).c_str()); _exit(1); }
-            dup2(fd, STDOUT_FILENO); // Redirige STDOUT
-            close(fd);
+// Espera a un hijo concreto reintentando si una señal interrumpe la espera.
+// Con wait4 se obtiene su rusage sin coste extra; se suma a usage si se pide.
+int wait_child(pid_t pid, CommandUsage *usage) {
+    int status = 0;
+    struct rusage ru;
+    {
+        TraceScope span("wait");
+        while (wait4(pid, &status, 0, &ru) < 0) {
+            if (errno != EINTR) { perror("waitpid"); return 1; }
         }
+    }
+    trace_child_end(pid);
+    if (usage) usage_add(*usage, ru);
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
 
-        std::string cmd_path = resolve_command_path(argv_tokens[0]);
-        if (cmd_path.find('/') != std::string::npos) {
-            execv(cmd_path.c_str(), argv.data()); // Ejecuta con ruta explícita
-            perror((std::string("execv ")+cmd_path).c_str());
-            _exit(1);
-        } else {
-            execvp(argv_tokens[0].c_str(), argv.data()); // Ejecuta buscando en PATH
-            perror((std::string("execvp ")+argv_tokens[0]).c_str());
-            _exit(1);
-        }
-    } else { // Código del padre
-        if (background) {
-            std::cout << "[background pid " << pid << "]\n"; // Proceso en segundo plano
-        } else {
-            int status;
-            if (waitpid(pid, &status, 0) < 0) perror("waitpid"); // Espera por el hijo
+// Buffer de captura de $(...): crece al doble con realloc (en bloques grandes glibc usa mremap,
+// así que crecer no copia lo ya leído) y se lee siempre con al menos 1 MiB libre por read()
+static char *capture_data = nullptr;
+static size_t capture_capacity = 0;
+static const size_t capture_min_read = 1 << 20;
+static const size_t capture_keep_limit = 64 << 20; // Por encima se devuelve al sistema al terminar la línea
+
+std::string_view read_capture(int fd) {
+    size_t size = 0;
+    while (true) {
+        if (capture_capacity - size < capture_min_read) {
+            size_t cap = std::max(capture_capacity * 2, size + capture_min_read);
+            char *p = static_cast<char*>(realloc(capture_data, cap));
+            if (!p) { perror("$(...): realloc"); break; } // Se queda con lo leído; el hijo recibirá SIGPIPE
+            capture_data = p;
+            capture_capacity = cap;
         }
+        ssize_t n = read(fd, capture_data + size, capture_capacity - size);
+        if (n > 0) { size += static_cast<size_t>(n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) perror("$(...): read");
+        break;
     }
+    return std::string_view(capture_data, size);
 }
 
-// Ejecuta dos comandos conectados por una tubería
-void execute_with_pipe(std::vector<std::string> left_tokens, std::vector<std::string> right_tokens, bool background) {
-    resolve_alias(left_tokens); // Expande alias comando izquierdo
-    resolve_alias(right_tokens); // Expande alias comando derecho
-    
-    int fd[2];
-    if (pipe(fd) < 0) { perror("pipe"); return; } // Crea la tubería
-
-    pid_t p1 = fork(); // Primer hijo (escritor del pipe)
-    if (p1 < 0) { perror("fork"); return; }
-    if (p1 == 0) {
-        // Restaura SIGINT
-        struct sigaction sa_default; sa_default.sa_handler = SIG_DFL;
-        sigemptyset(&sa_default.sa_mask); sa_default.sa_flags = 0;
-        sigaction(SIGINT, &sa_default, nullptr);
-        
-        dup2(fd[1], STDOUT_FILENO); // Redirige STDOUT al extremo de escritura
-        close(fd[0]); close(fd[1]); // Cierra descriptores no usados
-        
-        std::vector<char*> argv;
-        for (auto &s:left_tokens) argv.push_back(const_cast<char*>(s.c_str()));
-        argv.push_back(nullptr);
-        
-        std::string cmd_path = resolve_command_path(left_tokens[0]);
-        if (cmd_path.find('/') != std::string::npos) execv(cmd_path.c_str(), argv.data());
-        else execvp(left_tokens[0].c_str(), argv.data());
-        perror((std::string("exec left ")+left_tokens[0]).c_str());
-        _exit(1);
-    }
-
-    pid_t p2 = fork(); // Segundo hijo (lector del pipe)
-    if (p2 < 0) { perror("fork"); return; }
-    if (p2 == 0) {
-        // Restaura SIGINT
-        struct sigaction sa_default; sa_default.sa_handler = SIG_DFL;
-        sigemptyset(&sa_default.sa_mask); sa_default.sa_flags = 0;
-        sigaction(SIGINT, &sa_default, nullptr);
-        
-        dup2(fd[0], STDIN_FILENO); // Redirige STDIN al extremo de lectura
-        close(fd[0]); close(fd[1]); // Cierra descriptores no usados
-        
-        std::vector<char*> argv;
-        for (auto &s:right_tokens) argv.push_back(const_cast<char*>(s.c_str()));
-        argv.push_back(nullptr);
-        
-        std::string cmd_path = resolve_command_path(right_tokens[0]);
-        if (cmd_path.find('/') != std::string::npos) execv(cmd_path.c_str(), argv.data());
-        else execvp(right_tokens[0].c_str(), argv.data());
-        perror((std::string("exec right ")+right_tokens[0]).c_str());
-        _exit(1);
-    }
-
-    close(fd[0]); close(fd[1]); // Cierra ambos extremos del pipe en el padre. ¡Crucial!
+void capture_trim() {
+    if (capture_capacity <= capture_keep_limit) return;
+    free(capture_data);
+    capture_data = nullptr;
+    capture_capacity = 0;
+}
+
+// Ejecuta un comando simple (sin pipe), manejando alias, built-ins y redirecciones
+int execute_command_simple(std::vector<std::string> tokens, bool background, std::vector<bool> literal) {
+    if (tokens.empty()) return 0;
+    resolve_alias(tokens, &literal); // Expande alias
+    if (tokens.empty()) return 0;
+
+    if (is_builtin(tokens[0])) { // Ejecuta built-in en la shell, con sus redirecciones
+        int status = run_builtin(tokens, literal);
+        relay_join_pending(); // Con varios destinos, quedan completos antes de seguir
+        return status;
+    }
+
+    Redirections redir;
+    std::vector<std::string> argv_tokens;
+    if (!split_redirections(tokens, argv_tokens, redir, literal)) return 2;
+    if (argv_tokens.empty()) return 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    pid_t pid = spawn_command(argv_tokens, redir, -1, -1); // Crea proceso hijo
+    if (pid < 0) { relay_join_pending(); return 127; }
     if (background) {
-        std::cout << "[background pids " << p1 << " " << p2 << "]\n"; // Ejecución en segundo plano
-    } else {
-        int status;
-        waitpid(p1, &status, 0); // Espera por el escritor
-        waitpid(p2, &status, 0); // Espera por el lector
+        relay_detach_pending();
+        int id = job_add({pid}, join_words(tokens)); // Proceso en segundo plano
+        std::cout << "[" << id << "] " << pid << "\n";
+        return 0;
     }
+    CommandUsage usage;
+    int status = wait_child(pid, &usage); // Espera por el hijo
+    relay_join_pending();
+    usage.wall_ms = elapsed_ms(t0);
+    account_command(argv_tokens[0], usage);
+    return status;
+}
+
+// Camino rápido para un comando sin alias, built-in ni operadores: lanza directamente el argv
+// del arena del tokenizador, sin copiar las palabras a std::string
+int execute_argv(char *const argv[], bool background) {
+    auto t0 = std::chrono::steady_clock::now();
+    pid_t pid = spawn_argv(argv, Redirections(), -1, -1);
+    if (pid < 0) return 127;
+    if (background) {
+        std::vector<std::string> words;
+        for (size_t i=0; argv[i]; ++i) words.push_back(argv[i]);
+        int id = job_add({pid}, join_words(words)); // Proceso en segundo plano
+        std::cout << "[" << id << "] " << pid << "\n";
+        return 0;
+    }
+    CommandUsage usage;
+    int status = wait_child(pid, &usage);
+    usage.wall_ms = elapsed_ms(t0);
+    account_command(argv[0], usage);
+    return status;
+}
+
+// Agranda el buffer del pipe si se configuró 'pipesize' (menos cambios de contexto en cadenas largas)
+static void apply_pipe_size(int fd) {
+    if (pipe_buffer_size <= 0) return;
+    if (fcntl(fd, F_SETPIPE_SZ, pipe_buffer_size) < 0) perror("pipesize: F_SETPIPE_SZ");
+}
+
+// Ejecuta una tubería de N etapas: crea los pipes y lanza todos los hijos en una sola pasada.
+// Cada etapa admite sus propias redirecciones (normalmente '<' en la primera y '>'/'>>' en la última);
+// los destinos de una etapa intermedia reciben una copia y la etapa siguiente también (a > f | b).
+// Un built-in en la última etapa se ejecuta en la shell; en las demás, en un hijo creado con fork.
+int execute_pipeline(std::vector<std::vector<std::string>> stages, bool background, std::vector<std::vector<bool>> literal) {
+    size_t n = stages.size();
+    std::vector<std::vector<std::string>> argvs(n);
+    std::vector<Redirections> redirs(n);
+    literal.resize(n);
+    for (size_t i=0;i<n;++i) {
+        resolve_alias(stages[i], &literal[i]); // Expande alias de cada etapa
+        if (!split_redirections(stages[i], argvs[i], redirs[i], literal[i])) return 2;
+        if (argvs[i].empty()) { std::cerr << "Error: pipe sin comando\n"; return 2; }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<pid_t> pids;
+    int prev_read = -1; // Extremo de lectura del pipe anterior
+    bool builtin_last = false;
+    bool last_launched = false; // El estado de la tubería es el de la última etapa: sin ella, 127
+    for (size_t i=0;i<n;++i) {
+        // O_CLOEXEC: los extremos no usados no llegan a los hijos tras el dup2
+        int fd[2] = {-1, -1};
+        if (i+1 < n) {
+            if (pipe2(fd, O_CLOEXEC) < 0) { perror("pipe"); break; }
+            apply_pipe_size(fd[1]);
+        }
+        if (i+1 == n && !background && is_builtin(argvs[i][0])) { builtin_last = true; break; } // Se ejecuta en la shell tras lanzar el resto
+        // Si una etapa falla al lanzarse, se cierran sus extremos y las vecinas ven EOF/SIGPIPE
+        pid_t pid = is_builtin(argvs[i][0]) ? fork_builtin(argvs[i], redirs[i], prev_read, fd[1], fd[0])
+                                            : spawn_command(argvs[i], redirs[i], prev_read, fd[1]);
+        if (prev_read >= 0) close(prev_read);
+        if (fd[1] >= 0) close(fd[1]);
+        prev_read = fd[0];
+        if (pid > 0) pids.push_back(pid);
+        if (i+1 == n) last_launched = pid > 0;
+    }
+    int builtin_status = -1;
+    if (builtin_last) {
+        builtin_status = run_builtin_fds(argvs[n-1], redirs[n-1], prev_read, -1); // Última etapa en la shell
+    }
+    if (prev_read >= 0) close(prev_read); // Ningún extremo del pipe queda abierto en el padre. ¡Crucial!
+    if (pids.empty()) {
+        relay_join_pending();
+        return builtin_status >= 0 ? builtin_status : 127;
+    }
+
+    if (background) {
+        relay_detach_pending(); // Los repartidores terminan solos cuando sus etapas cierran la salida
+        std::string cmdline;
+        for (size_t i=0;i<n;++i) cmdline += (i ? " | " : "") + join_words(stages[i]);
+        int id = job_add(pids, cmdline); // Todas las etapas forman un único trabajo
+        std::cout << "[" << id << "]";
+        for (pid_t p: pids) std::cout << " " << p;
+        std::cout << "\n";
+        return 0;
+    }
+    int status = 0;
+    CommandUsage usage;
+    for (pid_t p: pids) status = wait_child(p, &usage); // Espera a toda la tubería; vale el estado de la última etapa
+    relay_join_pending();
+    if (builtin_status >= 0) status = builtin_status;
+    else if (!last_launched) status = 127; // 'true | nosuchcmd' falla aunque las demás etapas salgan con 0
+    usage.wall_ms = elapsed_ms(t0);
+    std::string name; // Las estadísticas de una tubería se agrupan como "a|b|c"
+    for (size_t i=0;i<n;++i) name += (i ? "|" : "") + argvs[i][0];
+    account_command(name, usage);
+    return status;
+}
+
+// Ejecuta dos comandos conectados por una tubería
+int execute_with_pipe(std::vector<std::string> left_tokens, std::vector<std::string> right_tokens, bool background) {
+    return execute_pipeline({left_tokens, right_tokens}, background);
 }
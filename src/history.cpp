@@ -0,0 +1,152 @@
+#include "history.hpp"
+#include <iostream>
+#include <iomanip>
+#include <cstring>      // memchr, memmem, memcmp
+#include <cstdint>
+#include <cstdlib>      // getenv
+#include <algorithm>    // std::upper_bound
+#include <fcntl.h>      // open
+#include <unistd.h>     // write, close
+#include <sys/mman.h>   // mmap, madvise
+#include <sys/stat.h>   // fstat
+#include <sys/file.h>   // flock
+
+// Proyección de solo lectura de un archivo que otras shells pueden hacer crecer
+struct MappedFile {
+    int fd = -1;
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+static MappedFile hist_data, hist_index;
+static bool history_ready = false;
+
+// Vuelve a proyectar el archivo si creció desde la última vez
+static void remap(MappedFile &m) {
+    struct stat st;
+    if (m.fd < 0 || fstat(m.fd, &st) != 0) return;
+    size_t size = static_cast<size_t>(st.st_size);
+    if (size == m.size && m.data) return;
+    if (m.data) munmap(const_cast<char*>(m.data), m.size);
+    m.data = nullptr;
+    m.size = 0;
+    if (size == 0) return;
+    void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, m.fd, 0);
+    if (p == MAP_FAILED) { perror("history: mmap"); return; }
+    m.data = static_cast<const char*>(p);
+    m.size = size;
+}
+
+// Devuelve las páginas leídas al page cache: el RSS de la shell no crece con el historial
+static void release(const MappedFile &m) {
+    if (m.data) madvise(const_cast<char*>(m.data), m.size, MADV_DONTNEED);
+}
+
+bool history_open() {
+    const char *env = getenv("MINISHELL_HISTFILE");
+    const char *home = getenv("HOME");
+    std::string path = env ? env : std::string(home ? home : ".") + "/.mini_shell_history";
+    hist_data.fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    hist_index.fd = open((path + ".idx").c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (hist_data.fd < 0 || hist_index.fd < 0) {
+        perror(("history: " + path).c_str());
+        if (hist_data.fd >= 0) close(hist_data.fd);
+        if (hist_index.fd >= 0) close(hist_index.fd);
+        hist_data.fd = hist_index.fd = -1;
+        return false;
+    }
+    remap(hist_data);
+    remap(hist_index);
+    history_ready = true;
+    return true;
+}
+
+// Anexa la entrada y su offset bajo flock: varias shells pueden escribir a la vez sin mezclarse
+void history_append(const std::string &line) {
+    if (!history_ready) return;
+    if (line.find('\n') != std::string::npos) return; // Una entrada por línea
+    flock(hist_index.fd, LOCK_EX);
+    struct stat st;
+    if (fstat(hist_data.fd, &st) == 0) {
+        uint64_t offset = static_cast<uint64_t>(st.st_size);
+        std::string rec = line + "\n";
+        if (write(hist_data.fd, rec.data(), rec.size()) == static_cast<ssize_t>(rec.size())) {
+            if (write(hist_index.fd, &offset, sizeof(offset)) != sizeof(offset)) perror("history: índice");
+        } else {
+            perror("history: escritura");
+        }
+    }
+    flock(hist_index.fd, LOCK_UN);
+}
+
+size_t history_count() {
+    if (!history_ready) return 0;
+    remap(hist_index);
+    return hist_index.size / sizeof(uint64_t);
+}
+
+static uint64_t entry_offset(size_t i) {
+    uint64_t off;
+    memcpy(&off, hist_index.data + i * sizeof(uint64_t), sizeof(off));
+    return off;
+}
+
+// Vista de la entrada i dentro del archivo de datos (sin el '\n')
+static bool entry_at(size_t i, const char *&start, size_t &len) {
+    uint64_t off = entry_offset(i);
+    if (off >= hist_data.size) return false; // Índice por delante de los datos (escritura en curso)
+    start = hist_data.data + off;
+    const char *nl = static_cast<const char*>(memchr(start, '\n', hist_data.size - off));
+    len = nl ? static_cast<size_t>(nl - start) : hist_data.size - off;
+    return true;
+}
+
+static void print_entry(size_t i) {
+    const char *start;
+    size_t len;
+    if (!entry_at(i, start, len)) return;
+    std::cout << std::setw(6) << i+1 << "  ";
+    std::cout.write(start, len);
+    std::cout << "\n";
+}
+
+void history_print_last(size_t n) {
+    size_t count = history_count();
+    remap(hist_data);
+    size_t first = (n == 0 || n >= count) ? 0 : count - n;
+    for (size_t i=first;i<count;++i) print_entry(i); // Acceso directo por el índice, sin recorrer lo anterior
+    release(hist_data);
+    release(hist_index);
+}
+
+// Búsqueda por subcadena (memmem sobre todo el archivo) o por prefijo (memcmp por entrada)
+void history_search(const std::string &pattern, bool prefix_only) {
+    size_t count = history_count();
+    remap(hist_data);
+    if (count == 0 || !hist_data.data || pattern.empty()) return;
+    if (prefix_only) {
+        for (size_t i=0;i<count;++i) {
+            const char *start;
+            size_t len;
+            if (entry_at(i, start, len) && len >= pattern.size() && memcmp(start, pattern.data(), pattern.size()) == 0)
+                print_entry(i);
+        }
+    } else {
+        const uint64_t *offsets = reinterpret_cast<const uint64_t*>(hist_index.data);
+        const char *pos = hist_data.data;
+        const char *end = hist_data.data + hist_data.size;
+        while (pos < end) {
+            const char *hit = static_cast<const char*>(memmem(pos, end - pos, pattern.data(), pattern.size()));
+            if (!hit) break;
+            // La entrada que contiene la coincidencia: último offset <= posición
+            uint64_t off = static_cast<uint64_t>(hit - hist_data.data);
+            size_t i = static_cast<size_t>(std::upper_bound(offsets, offsets + count, off) - offsets);
+            if (i == 0) break;
+            print_entry(i-1);
+            if (i >= count) break;
+            pos = hist_data.data + entry_offset(i); // Sigue en la entrada siguiente
+        }
+    }
+    release(hist_data);
+    release(hist_index);
+}
@@ -2,11 +2,183 @@
 #include "executor.hpp"
 #include "builtins.hpp"
 #include "signals.hpp"
+#include "accounting.hpp"
+#include "history.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <csignal>      // Para sigaction
-#include <algorithm>    // Para std::find
+#include <cstring>      // Para strcmp
+#include <fcntl.h>      // Para open
+#include <unistd.h>     // Para isatty, close
 
-int main() {
+// Comando externo sin alias ni operadores: se puede lanzar directamente desde el argv del arena
+static bool is_plain(const TokenArena &arena) {
+    std::string first(arena.words[0]);
+    std::shared_ptr<const AliasMap> alias_map = alias_snapshot();
+    if (is_builtin(first) || alias_map->find(first) != alias_map->end()) return false;
+    for (size_t i=1; i<arena.words.size(); ++i)
+        if (!arena.literal[i] && is_operator_word(arena.words[i])) return false; // Entre comillas es un argumento
+    return true;
+}
+
+// Ejecuta las palabras ya tokenizadas de una línea
+static int run_words(const TokenArena &arena, bool background) {
+    if (arena.words.empty()) return 0;
+
+    // Camino rápido: comando externo sin alias ni operadores, lanzado desde el argv del arena
+    if (is_plain(arena)) return execute_argv(arena.argv.data(), background);
+
+    std::vector<std::string> tokens(arena.words.begin(), arena.words.end());
+
+    bool pipe = false;
+    for (size_t i=0; i<tokens.size() && !pipe; ++i) pipe = !arena.literal[i] && tokens[i] == "|";
+    if (pipe) {
+        // Divide en etapas separadas por '|' (un "|" entre comillas es un argumento)
+        std::vector<std::vector<std::string>> stages(1);
+        std::vector<std::vector<bool>> literal(1);
+        for (size_t i=0; i<tokens.size(); ++i) {
+            if (!arena.literal[i] && tokens[i] == "|") { stages.emplace_back(); literal.emplace_back(); continue; }
+            stages.back().push_back(std::move(tokens[i]));
+            literal.back().push_back(arena.literal[i]);
+        }
+        return execute_pipeline(stages, background, literal); // Ejecuta la tubería completa
+    }
+    return execute_command_simple(tokens, background, arena.literal); // Ejecuta comando simple
+}
+
+// Ejecuta una línea ya limpia y devuelve su código de salida
+static int run_line(std::string line) {
+    // time <cmd>: ejecuta el resto de la línea y muestra la suma de los recursos de todos sus hijos
+    // (wait4) y de la propia shell
+    if (line.rfind("time ", 0) == 0) {
+        UsageTimer timer;
+        usage_timer_start(timer);
+        int status = run_line(trim(line.substr(5)));
+        print_usage(usage_timer_stop(timer));
+        return status;
+    }
+
+    // Detecta casos especiales paralelos para preservar el resto de la línea
+    if (line.rfind("parallel ", 0) == 0) { // Comprueba si comienza con "parallel "
+        std::string rest = trim(line.substr(std::string("parallel ").size())); // Extrae el resto
+        return run_parallel_from_line(rest); // Ejecuta en paralelo
+    }
+
+    // detección de fondo: '&' final fuera de comillas y sin escapar ('echo a\\&' imprime "a&")
+    std::string_view text(line);
+    bool background = strip_background(text);
+    if (background) line = std::string(text); // Elimina el '&'
+
+    static TokenArena arena; // Reutilizado entre líneas: sin reservas nuevas en cada comando
+    {
+        TraceScope span("tokenize");
+        if (!tokenize_into(line, arena)) { capture_trim(); return 2; } // Tokeniza el comando
+    }
+    int status = run_words(arena, background);
+    if (arena.buf.capacity() > (64u << 20) || arena.starts.capacity() > (1u << 20)) arena.release(); // Tras un $(...) enorme no se retiene la memoria
+    capture_trim();
+    return status;
+}
+
+// Ejecuta una lista 'a ; b && c || d'. Cada comando se tokeniza justo antes de ejecutarse, así que
+// su $? y sus $(...) ven el resultado del anterior; && y || saltan según el último estado.
+// Ctrl+C corta la lista, como en sh.
+static int run_list(const std::string &line) {
+    std::vector<ListItem> items;
+    if (!split_command_list(line, items)) return last_status = 2;
+    interrupt_received = 0;
+    for (const ListItem &item: items) {
+        if (item.op == ListOp::And && last_status != 0) continue;
+        if (item.op == ListOp::Or && last_status == 0) continue;
+        last_status = run_line(std::string(item.text));
+        if (interrupt_received) break;
+    }
+    return last_status;
+}
+
+// $(...): ejecuta el texto con su stdout en un pipe y lee la salida en el buffer de captura.
+// Un comando externo sin operadores se lanza con posix_spawn; lo demás (built-ins, alias,
+// tuberías, redirecciones) corre en un hijo creado con fork, como una subshell. Un '&' final
+// no tiene efecto: la sustitución espera igualmente a que se cierre su salida.
+static bool substitute_command(std::string_view text, std::string_view &output) {
+    strip_background(text);
+    std::vector<ListItem> items;
+    if (!split_command_list(text, items)) return false;
+    bool list = items.size() > 1; // Una lista se tokeniza en el hijo, comando a comando
+    TokenArena inner; // Propio: la línea exterior sigue a medio tokenizar y puede haber $(...) anidados
+    if (!list && !tokenize_into(text, inner)) return false;
+    output = std::string_view();
+    if (!list && inner.words.empty()) return true;
+    int fd[2];
+    if (pipe2(fd, O_CLOEXEC) < 0) { perror("pipe"); return false; }
+    fcntl(fd[0], F_SETPIPE_SZ, 1 << 20); // Menos despertares con salidas grandes (si pipe-max-size lo permite)
+    pid_t pid;
+    if (!list && is_plain(inner)) {
+        pid = spawn_argv(inner.argv.data(), Redirections(), -1, fd[1]);
+    } else {
+        pid = fork_child(); // SIGINT por defecto y sin mutex tomados por otros hilos
+        if (pid == 0) { // Código del hijo
+            dup2(fd[1], STDOUT_FILENO);
+            // Listas, time y parallel se reconocen por el texto de la línea
+            int status = (list || inner.words[0] == "time" || inner.words[0] == "parallel") ? run_list(std::string(text)) : run_words(inner, false);
+            std::cout.flush();
+            _exit(status);
+        }
+        if (pid < 0) perror("fork");
+    }
+    close(fd[1]);
+    if (pid < 0) { close(fd[0]); return false; }
+    output = read_capture(fd[0]);
+    close(fd[0]);
+    CommandUsage usage;
+    wait_child(pid, &usage);
+    account_command("", usage); // Sin nombre: no entra en stats, pero sí en un 'time' en curso
+    return true;
+}
+
+// Modo no interactivo (-c, script o stdin que no es una terminal): sin prompt ni historial,
+// lectura con un buffer grande y salida con el estado del último comando
+static int run_batch(int fd) {
+    LineReader reader(fd, 1 << 20);
+    std::string line;
+    int status = 0;
+    while (reader.next(line)) {
+        if (child_terminated) reap_children_nonblocking(); // Recolecta procesos zombies
+        std::string_view v;
+        {
+            TraceScope span("trim");
+            v = trim_view(line);
+        }
+        if (v.empty() || v[0] == '#') continue; // Líneas vacías y comentarios
+        if (v.size() != line.size()) line.assign(v); // Solo copia si había espacios que quitar
+        TraceScope span("line");
+        status = run_list(line);
+    }
+    return status;
+}
+
+// Ejecuta el texto de -c; puede contener varias líneas
+static int run_string(const std::string &text) {
+    int status = 0;
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t nl = text.find('\n', pos);
+        if (nl == std::string::npos) nl = text.size();
+        std::string line;
+        {
+            TraceScope span("trim");
+            line = trim(text.substr(pos, nl - pos));
+        }
+        if (!line.empty() && line[0] != '#') {
+            TraceScope span("line");
+            status = run_list(line);
+        }
+        pos = nl + 1;
+    }
+    return status;
+}
+
+int main(int argc, char **argv) {
     // Configuración del manejador de la señal SIGCHLD (hijos terminados)
     struct sigaction sa_chld;
     sa_chld.sa_handler = sigchld_handler; // Llama a sigchld_handler
@@ -21,8 +193,23 @@ int main() {
     sa_int.sa_flags = SA_RESTART;
     sigaction(SIGINT, &sa_int, nullptr); // Establece el manejador
 
+    command_substitution = substitute_command; // El tokenizador ejecuta $(...) a través de la shell
+
+    // Modos no interactivos: mini_shell -c 'cmd' | mini_shell script.msh | stdin desde archivo o pipe
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0) return run_string(argv[2]);
+    if (argc == 2 && strcmp(argv[1], "-c") == 0) { std::cerr << "mini_shell: -c requiere un argumento\n"; return 2; }
+    if (argc >= 2) {
+        int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { perror(argv[1]); return 127; }
+        int status = run_batch(fd);
+        close(fd);
+        return status;
+    }
+    if (!isatty(STDIN_FILENO)) return run_batch(STDIN_FILENO);
+
     std::string line;
     std::string prompt = "mini-shell$ ";
+    history_open(); // Solo el modo interactivo usa historial
 
     while (true) {
         if (child_terminated) reap_children_nonblocking(); // Recolecta procesos zombies si la bandera está activa
@@ -31,47 +218,16 @@ int main() {
         std::cout.flush(); // Asegura que el prompt se muestre inmediatamente
         if (!std::getline(std::cin, line)) break; // Lee la línea de entrada (o sale si EOF/Ctrl+D)
         
-        line = trim(line); // Limpia espacios en blanco
-        if (line.empty()) continue;
-
-        // historial (protegido)
         {
-            std::lock_guard<std::mutex> lk(builtins_mutex); // Bloquea el mutex para el historial
-            history_list.push_back(line); // Añade el comando al historial
-        }
-
-        // Detecta casos especiales paralelos para preservar el resto de la línea
-        if (line.rfind("parallel ", 0) == 0) { // Comprueba si comienza con "parallel "
-            std::string rest = trim(line.substr(std::string("parallel ").size())); // Extrae el resto
-            run_parallel_from_line(rest); // Ejecuta en paralelo
-            continue;
+            TraceScope span("trim");
+            line = trim(line); // Limpia espacios en blanco
         }
+        if (line.empty()) continue;
 
-        // detección de fondo (signo & separado por espacio o al final)
-        bool background = false;
-        if (!line.empty() && line.back() == '&') {
-            background = true; // Marca como ejecución en segundo plano
-            line = trim(line.substr(0, line.size()-1)); // Elimina el '&'
-        }
-
-        std::vector<std::string> tokens = tokenize(line); // Tokeniza el comando
-        if (tokens.empty()) continue;
-
-        // comprobación rápida incorporada
-        if (is_builtin(tokens[0])) {
-            handle_builtin(tokens); // Ejecuta el built-in
-            continue;
-        }
+        history_append(line); // Añade el comando al historial persistente
 
-        auto it_pipe = std::find(tokens.begin(), tokens.end(), "|"); // Busca el operador de pipe
-        if (it_pipe != tokens.end()) {
-            // Divide en comandos izquierdo y derecho
-            std::vector<std::string> left(tokens.begin(), it_pipe);
-            std::vector<std::string> right(it_pipe+1, tokens.end());
-            execute_with_pipe(left, right, background); // Ejecuta con pipe
-        } else {
-            execute_command_simple(tokens, background); // Ejecuta comando simple
-        }
+        TraceScope span("line"); // De Enter al final del comando
+        run_list(line);
     }
 
     std::cout << "\nSaliendo de mini-shell...\n";
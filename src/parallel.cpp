@@ -0,0 +1,296 @@
+#include "parallel.hpp"
+#include "executor.hpp"
+#include "builtins.hpp"
+#include "parser.hpp"
+#include "accounting.hpp"
+#include "trace.hpp"
+#include "relay.hpp"
+#include "signals.hpp"
+#include <iostream>
+#include <map>
+#include <chrono>
+#include <unistd.h>         // sysconf, close, read, syscall
+#include <fcntl.h>          // open, fcntl, O_NONBLOCK
+#include <sys/epoll.h>      // epoll_create1, epoll_wait
+#include <sys/syscall.h>    // SYS_pidfd_open
+#include <sys/wait.h>       // waitpid
+#include <errno.h>
+#include <cstdlib>          // atoi
+
+// Un comando lanzado y todavía no emitido
+struct RunningJob {
+    pid_t pid = -1;
+    int pidfd = -1;         // Vigilado en epoll hasta que el hijo termina
+    int out_fd = -1;        // Extremo de lectura del stdout capturado (-1 si no hay captura o ya hubo EOF)
+    bool launched = false;  // Tiene hijo y ocupa una plaza hasta estar completo
+    int cpu_slot = -1;      // CPU asignado con --pin
+    bool exited = false;
+    int status = 0;
+    std::string name;       // Nombre del comando (estadísticas)
+    std::chrono::steady_clock::time_point start;
+    std::string display;    // Texto del comando para los informes
+    std::string output;     // stdout capturado
+};
+
+int online_cpu_count() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+static int pidfd_open(pid_t pid) {
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+// Lanza un comando; devuelve false si terminó sin hijo (built-in o error de lanzamiento)
+static bool launch(std::vector<std::string> &tokens, std::vector<bool> &literal, const RunnerOptions &opts, PlacementRun &placement, RunningJob &job) {
+    resolve_alias(tokens, &literal); // Expande alias
+    if (tokens.empty()) return false;
+    if (is_builtin(tokens[0])) {
+        job.status = run_builtin(tokens, literal); // Los built-ins se ejecutan en la shell, sin hijo
+        return false;
+    }
+    Redirections redir;
+    std::vector<std::string> argv_tokens;
+    if (!split_redirections(tokens, argv_tokens, redir, literal) || argv_tokens.empty()) { job.status = 2; return false; }
+    int fd[2] = {-1, -1};
+    if (opts.capture && pipe2(fd, O_CLOEXEC) < 0) { perror("pipe"); job.status = 1; return false; }
+    job.name = argv_tokens[0];
+    job.start = std::chrono::steady_clock::now();
+    job.cpu_slot = placement_acquire(placement);
+    job.pid = spawn_command(argv_tokens, redir, opts.stdin_fd, fd[1]);
+    placement_spawned(placement, job.pid);
+    if (fd[1] >= 0) close(fd[1]);
+    if (job.pid < 0) {
+        placement_release(placement, job.cpu_slot);
+        if (fd[0] >= 0) close(fd[0]);
+        job.status = 127;
+        return false;
+    }
+    if (fd[0] >= 0) {
+        fcntl(fd[0], F_SETFL, O_NONBLOCK);
+        job.out_fd = fd[0];
+    }
+    return true;
+}
+
+// Vacía lo disponible en el pipe de un trabajo; cierra el extremo al llegar a EOF
+static void drain_output(int epfd, RunningJob &job) {
+    static char chunk[1 << 16];
+    while (job.out_fd >= 0) {
+        ssize_t n = read(job.out_fd, chunk, sizeof(chunk));
+        if (n > 0) { job.output.append(chunk, n); continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        epoll_ctl(epfd, EPOLL_CTL_DEL, job.out_fd, nullptr);
+        close(job.out_fd);
+        job.out_fd = -1;
+    }
+}
+
+// Emite la salida capturada de un trabajo terminado e informa su estado
+static void finish(size_t index, RunningJob &job, const RunnerOptions &opts, int &failures) {
+    if (!job.output.empty()) {
+        std::cout.write(job.output.data(), job.output.size());
+        std::cout.flush();
+    }
+    if (job.status != 0) ++failures;
+    if (opts.verbose)
+        std::cout << "[parallel " << index+1 << "] salida " << job.status << ": " << job.display << "\n";
+    else if (job.status != 0)
+        std::cerr << "[" << index+1 << "] salida " << job.status << ": " << job.display << "\n";
+}
+
+// Bucle de eventos: mantiene max_jobs hijos vivos y lanza el siguiente en cuanto uno termina.
+// Cada hijo se vigila con su pidfd en epoll (y su pipe de salida si hay captura), así que no hay
+// hilos ni waitpid(-1) compitiendo. Con salida ordenada, como mucho 4*max_jobs trabajos pueden
+// estar lanzados sin emitir: la memoria no depende del número de entradas.
+int run_jobs(const CommandSource &source, const RunnerOptions &opts) {
+    TraceScope span("parallel");
+    PlacementRun placement;
+    bool placed = placement_begin(opts.placement, placement);
+    if (opts.placement.active() && !placed) return 1; // Colocación imposible (ya informada): no se lanza nada
+    int max_jobs = opts.max_jobs;
+    if (max_jobs < 1) max_jobs = placed ? static_cast<int>(placement.child_cpus.size()) : online_cpu_count();
+    bool in_order = opts.capture && opts.ordered;
+    size_t window = 4 * static_cast<size_t>(max_jobs);
+    int failures = 0;
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) { perror("epoll_create1"); placement_end(placement); return 1; }
+
+    std::map<size_t, RunningJob> jobs; // índice -> trabajo (lanzado o terminado sin emitir)
+    std::map<int, size_t> fd_owner;     // pidfd/pipe -> índice del trabajo
+    size_t running = 0, next_index = 0, next_emit = 0;
+    bool exhausted = false;
+    interrupt_received = 0; // Ctrl+C mata a los hijos vivos (mismo grupo); además no se lanzan más
+
+    // Un trabajo está completo cuando el hijo terminó y su pipe llegó a EOF
+    auto complete = [&](size_t index) {
+        RunningJob &job = jobs[index];
+        if (!job.exited || job.out_fd >= 0) return;
+        if (job.launched) { job.launched = false; --running; placement_release(placement, job.cpu_slot); } // Libera la plaza
+        if (!in_order) {
+            finish(index, job, opts, failures);
+            jobs.erase(index);
+            return;
+        }
+        while (!jobs.empty() && jobs.begin()->first == next_emit && jobs.begin()->second.exited && jobs.begin()->second.out_fd < 0) {
+            finish(next_emit, jobs.begin()->second, opts, failures);
+            jobs.erase(jobs.begin());
+            ++next_emit;
+        }
+    };
+
+    while (!exhausted || running > 0) {
+        // Rellena las plazas libres
+        if (interrupt_received && !exhausted) {
+            std::cerr << "interrumpido (Ctrl+C): no se lanzan más comandos\n";
+            exhausted = true;
+        }
+        while (!exhausted && running < static_cast<size_t>(max_jobs) && (!in_order || next_index - next_emit < window)) {
+            std::vector<std::string> tokens;
+            std::vector<bool> literal;
+            std::string display;
+            if (!source(tokens, literal, display)) { exhausted = true; break; }
+            size_t index = next_index++;
+            RunningJob &job = jobs[index];
+            job.display = display;
+            if (!launch(tokens, literal, opts, placement, job)) { job.exited = true; complete(index); continue; }
+            job.pidfd = pidfd_open(job.pid);
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = job.pidfd;
+            if (job.pidfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, job.pidfd, &ev) < 0) {
+                // Kernel sin pidfd (< 5.3): se espera a este hijo de forma síncrona. Cuenta como
+                // lanzado para que complete() libere su CPU (placement_acquire ya la tomó).
+                if (job.pidfd >= 0) close(job.pidfd);
+                job.pidfd = -1;
+                job.launched = true;
+                ++running;
+                while (job.out_fd >= 0) { fcntl(job.out_fd, F_SETFL, 0); drain_output(epfd, job); }
+                job.status = wait_child(job.pid);
+                job.exited = true;
+                complete(index);
+                continue;
+            }
+            fd_owner[job.pidfd] = index;
+            if (job.out_fd >= 0) {
+                ev.data.fd = job.out_fd;
+                epoll_ctl(epfd, EPOLL_CTL_ADD, job.out_fd, &ev);
+                fd_owner[job.out_fd] = index;
+            }
+            job.launched = true;
+            ++running;
+        }
+        if (running == 0) continue;
+
+        // Espera a que termine un hijo o haya salida que leer
+        struct epoll_event events[64];
+        int n = epoll_wait(epfd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue; // Ctrl+C u otra señal: los hijos la reciben igualmente
+            perror("epoll_wait");
+            break;
+        }
+        for (int i=0;i<n;++i) {
+            auto owner = fd_owner.find(events[i].data.fd);
+            if (owner == fd_owner.end()) continue;
+            size_t index = owner->second;
+            RunningJob &job = jobs[index];
+            if (events[i].data.fd == job.out_fd) {
+                drain_output(epfd, job);
+                if (job.out_fd < 0) fd_owner.erase(owner);
+            } else {
+                CommandUsage usage;
+                job.status = wait_child(job.pid, &usage); // Ya terminó: no bloquea
+                usage.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.start).count();
+                account_command(job.name, usage);
+                job.exited = true;
+                epoll_ctl(epfd, EPOLL_CTL_DEL, job.pidfd, nullptr);
+                close(job.pidfd);
+                fd_owner.erase(owner);
+                job.pidfd = -1;
+            }
+            complete(index);
+        }
+    }
+    // Si epoll falló, no se dejan zombies ni descriptores abiertos
+    for (auto &p: jobs) {
+        RunningJob &job = p.second;
+        if (job.out_fd >= 0) close(job.out_fd);
+        if (job.pidfd >= 0) { close(job.pidfd); job.status = wait_child(job.pid); ++failures; }
+    }
+    close(epfd);
+    relay_join_pending(); // Destinos múltiples de los comandos (cmd > a > b)
+    placement_end(placement);
+    return failures;
+}
+
+int run_bounded(const std::vector<std::string> &cmds, int max_jobs, const Placement &placement) {
+    size_t next = 0;
+    RunnerOptions opts;
+    opts.max_jobs = max_jobs;
+    opts.placement = placement;
+    return run_jobs([&](std::vector<std::string> &tokens, std::vector<bool> &literal, std::string &display) {
+        if (next >= cmds.size()) return false;
+        display = cmds[next++];
+        tokens = tokenize(display, true, &literal);
+        return true;
+    }, opts);
+}
+
+// Sustituye cada "{}" del token por la entrada (sin volver a dividir: nombres con espacios funcionan)
+static std::string substitute(const std::string &tok, const std::string &input) {
+    std::string out;
+    size_t pos = 0, p;
+    while ((p = tok.find("{}", pos)) != std::string::npos) {
+        out.append(tok, pos, p - pos);
+        out += input;
+        pos = p + 2;
+    }
+    out.append(tok, pos, std::string::npos);
+    return out;
+}
+
+// pmap: ejecuta la plantilla una vez por cada línea de STDIN (normalmente '< lista'), leída en streaming
+int run_pmap(const std::vector<std::string> &tokens) {
+    RunnerOptions opts;
+    opts.capture = true;
+    opts.verbose = false;
+    std::vector<std::string> tmpl;
+    bool bad = false;
+    for (size_t i=1;i<tokens.size() && !bad;++i) {
+        int used = tmpl.empty() ? placement_option(tokens, i, opts.placement) : 0;
+        if (used < 0) return 2;
+        if (used > 0) { i += used - 1; continue; }
+        if (tmpl.empty() && tokens[i]=="-j" && i+1<tokens.size()) bad = (opts.max_jobs = atoi(tokens[++i].c_str())) < 1;
+        else if (tmpl.empty() && tokens[i]=="-c") opts.ordered = false; // Orden de terminación
+        else tmpl.push_back(tokens[i]);
+    }
+    if (tmpl.empty() || bad) { std::cerr << "Uso: pmap [-j N] [-c] [--pin] [--cpus L] [--reserve] [--nice N] [--ionice C] cmd ... {} ... < lista\n"; return 2; }
+
+    // La lista llega por STDIN (el ejecutor ya aplicó '< lista'); los hijos leen /dev/null para no consumirla
+    int devnull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    opts.stdin_fd = devnull;
+    bool has_placeholder = false;
+    for (auto &t: tmpl) if (t.find("{}") != std::string::npos) has_placeholder = true;
+
+    LineReader reader(STDIN_FILENO);
+    std::string input;
+    size_t total = 0;
+    int failures = run_jobs([&](std::vector<std::string> &argv, std::vector<bool> &literal, std::string &display) {
+        do {
+            if (!reader.next(input)) return false;
+        } while (input.empty()); // Las líneas vacías no generan trabajos
+        ++total;
+        argv.clear();
+        for (auto &t: tmpl) argv.push_back(substitute(t, input));
+        if (!has_placeholder) argv.push_back(input); // Sin "{}", la entrada va como último argumento
+        // Las redirecciones de la línea de pmap ya se aplicaron: lo que queda (plantilla y entradas) son argumentos
+        literal.assign(argv.size(), true);
+        display = input;
+        return true;
+    }, opts);
+    if (devnull >= 0) close(devnull);
+    if (failures > 0) std::cerr << "pmap: " << total << " entradas, " << failures << " fallidas\n";
+    return failures > 0 ? 1 : 0;
+}
@@ -1,21 +1,362 @@
 #include "parser.hpp"
-#include <sstream>      // Para std::istringstream
+#include "wildcard.hpp"
+#include <iostream>     // Para std::cerr
 #include <vector>       // Para std::vector
 #include <string>       // Para std::string
+#include <cstring>      // Para memchr
+#include <algorithm>    // Para std::min
+#include <unistd.h>     // Para read
+#include <errno.h>
 
-// Elimina espacios en blanco (espacios, tabs, newlines, retornos de carro) al principio y al final de una cadena
+static bool is_space(char c) {
+    return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
+
+// Elimina espacios en blanco (espacios, tabs, newlines, retornos de carro) al principio y al final, sin copiar
+std::string_view trim_view(std::string_view s) {
+    size_t a = 0, b = s.size();
+    while (a < b && is_space(s[a])) ++a; // Primer no-espacio
+    while (b > a && is_space(s[b-1])) --b; // Último no-espacio
+    return s.substr(a, b - a);
+}
+
+// Elimina espacios en blanco al principio y al final de una cadena
 std::string trim(const std::string &s) {
-    size_t a = s.find_first_not_of(" \t\n\r"); // Encuentra el primer no-espacio
-    if (a == std::string::npos) return ""; // Si solo hay espacios o está vacía
-    size_t b = s.find_last_not_of(" \t\n\r"); // Encuentra el último no-espacio
-    return s.substr(a, b - a + 1); // Retorna la subcadena limpia
-}
-
-// Divide una cadena de entrada en tokens (palabras) usando espacios en blanco como delimitador
-std::vector<std::string> tokenize(const std::string &line) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(line); // Stream a partir de la línea
-    std::string t;
-    while (iss >> t) tokens.push_back(t); // Extrae y almacena cada token
-    return tokens;
+    return std::string(trim_view(s));
+}
+
+void TokenArena::clear() {
+    buf.clear();
+    starts.clear();
+    words.clear();
+    argv.clear();
+    literal.clear();
+    quoted_meta.clear();
+}
+
+void TokenArena::release() {
+    *this = TokenArena();
+    buf.shrink_to_fit(); // La asignación de una cadena corta conserva la capacidad anterior
+    pattern.shrink_to_fit();
+}
+
+static bool is_glob_meta(char c) {
+    return c=='*' || c=='?' || c=='[' || c=='\\';
+}
+
+// Anota los comodines que llegan entre comillas o escapados: no deben expandirse
+static void mark_quoted(TokenArena &arena, size_t from) {
+    for (size_t k=from;k<arena.buf.size();++k)
+        if (is_glob_meta(arena.buf[k])) arena.quoted_meta.push_back(k);
+}
+
+// Sustituye la palabra que empieza en start por sus coincidencias (si las hay)
+static void expand_word(TokenArena &arena, size_t start) {
+    std::string &pattern = arena.pattern;
+    pattern.clear();
+    size_t q = 0;
+    for (size_t k=start;k<arena.buf.size();++k) {
+        if (q < arena.quoted_meta.size() && arena.quoted_meta[q] == k) { pattern += '\\'; ++q; }
+        pattern += arena.buf[k];
+    }
+    arena.matches.clear();
+    if (!glob_expand(pattern, arena.matches)) return; // Sin coincidencias la palabra queda literal
+    arena.buf.resize(start);
+    arena.starts.pop_back();
+    for (size_t k=0;k<arena.matches.size();++k) {
+        if (k) arena.buf.push_back('\0');
+        arena.starts.push_back(arena.buf.size());
+        arena.buf += arena.matches[k];
+    }
+}
+
+SubstitutionFn command_substitution = nullptr;
+int last_status = 0;
+
+// Posición del ')' que cierra el "$(" de line[open]; npos si no se cierra.
+// Se cuentan los paréntesis anidados y se saltan comillas y '\' del interior.
+static size_t find_substitution_end(std::string_view line, size_t open) {
+    int depth = 0;
+    for (size_t i = open + 1; i < line.size(); ++i) {
+        char c = line[i];
+        if (c == '\\') {
+            ++i;
+        } else if (c == '\'') {
+            i = line.find('\'', i+1);
+            if (i == std::string_view::npos) return i;
+        } else if (c == '"') {
+            for (++i; i < line.size() && line[i] != '"'; ++i) if (line[i] == '\\') ++i;
+            if (i >= line.size()) return std::string_view::npos;
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')' && --depth == 0) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Ejecuta el interior de $(...) en line[i]; deja en output su salida sin los '\n' finales y en i la posición tras ')'
+static bool substitute_at(std::string_view line, size_t &i, std::string_view &output) {
+    size_t e = find_substitution_end(line, i);
+    if (e == std::string_view::npos) { std::cerr << "Error: $( sin cerrar\n"; return false; }
+    if (!command_substitution) { std::cerr << "Error: $(...) no disponible\n"; return false; }
+    if (!command_substitution(line.substr(i+2, e-i-2), output)) return false;
+    while (!output.empty() && output.back() == '\n') output.remove_suffix(1);
+    i = e + 1;
+    return true;
+}
+
+// Salta la construcción entre comillas, escapada o $(...) que empieza en line[i]: devuelve la
+// posición de su último carácter (i si line[i] no abre ninguna) o npos si no se cierra
+static size_t skip_quoted(std::string_view line, size_t i) {
+    size_t n = line.size();
+    char c = line[i];
+    if (c == '\\') return i + 1 < n ? i + 1 : i;
+    if (c == '\'') return line.find('\'', i+1);
+    if (c == '$' && i+1 < n && line[i+1] == '(') return find_substitution_end(line, i);
+    if (c != '"') return i;
+    for (++i; i < n && line[i] != '"'; ++i) {
+        if (line[i] == '\\') ++i;
+        else if (line[i] == '$' && i+1 < n && line[i+1] == '(') {
+            i = find_substitution_end(line, i);
+            if (i == std::string_view::npos) return i;
+        }
+    }
+    return i < n ? i : std::string_view::npos;
+}
+
+bool strip_background(std::string_view &line) {
+    line = trim_view(line);
+    size_t n = line.size();
+    if (n == 0 || line[n-1] != '&') return false;
+    // El '&' final cuenta solo si está fuera de comillas y sin escapar
+    for (size_t i = 0; i + 1 < n; ++i) {
+        i = skip_quoted(line, i);
+        if (i == std::string_view::npos || i >= n - 1) return false;
+    }
+    line = trim_view(line.substr(0, n-1));
+    return true;
+}
+
+bool split_raw_words(std::string_view line, std::vector<std::string> &words, std::vector<bool> &dynamic) {
+    words.clear();
+    dynamic.clear();
+    size_t i = 0, n = line.size();
+    while (true) {
+        while (i < n && is_space(line[i])) ++i;
+        if (i >= n) break;
+        size_t start = i;
+        bool dyn = false;
+        for (; i < n && !is_space(line[i]); ++i) {
+            char c = line[i];
+            if (c == '$' && i+1 < n && (line[i+1] == '(' || line[i+1] == '?')) dyn = true;
+            else if (c == '*' || c == '?' || c == '[') dyn = true;
+            size_t e = skip_quoted(line, i);
+            if (e == std::string_view::npos) { std::cerr << "Error: comilla o $( sin cerrar\n"; return false; }
+            if (c == '"') { // Entre comillas dobles también se sustituyen $(...) y $?
+                for (size_t k = i+1; k < e; ++k) {
+                    if (line[k] == '\\') ++k;
+                    else if (line[k] == '$' && (line[k+1] == '(' || line[k+1] == '?')) dyn = true;
+                }
+            }
+            i = e;
+        }
+        words.emplace_back(line.substr(start, i - start));
+        dynamic.push_back(dyn);
+    }
+    return true;
+}
+
+// Recorre la línea una vez; solo mira los operadores fuera de comillas y de $(...), que se
+// saltan enteros (sus comillas sin cerrar las informa después el tokenizador)
+bool split_command_list(std::string_view line, std::vector<ListItem> &items) {
+    items.clear();
+    size_t n = line.size(), start = 0;
+    ListOp op = ListOp::Seq;
+    auto push = [&](size_t end, ListOp next, const char *sep) {
+        std::string_view text = trim_view(line.substr(start, end - start));
+        // ';' y '&' admiten un comando vacío detrás (al final de la línea), && y || no
+        if (text.empty() || text == "&") {
+            std::cerr << "Error de sintaxis cerca de '" << sep << "'\n";
+            return false;
+        }
+        items.push_back({op, text});
+        op = next;
+        return true;
+    };
+    for (size_t i = 0; i < n; ++i) {
+        char c = line[i];
+        if (c == '\\' || c == '\'' || c == '"' || (c == '$' && i+1 < n && line[i+1] == '(')) {
+            i = skip_quoted(line, i);
+            if (i == std::string_view::npos) break;
+        } else if (c == ';') {
+            if (i+1 < n && line[i+1] == ';') { ++i; continue; } // ';;' de parallel
+            if (!push(i, ListOp::Seq, ";")) return false;
+            start = i + 1;
+        } else if ((c == '&' || c == '|') && i+1 < n && line[i+1] == c) {
+            if (!push(i, c == '&' ? ListOp::And : ListOp::Or, c == '&' ? "&&" : "||")) return false;
+            start = i + 2;
+            ++i;
+        } else if (c == '&') {
+            if (!push(i + 1, ListOp::Seq, "&")) return false; // El '&' queda en el texto: segundo plano
+            start = i + 1;
+        }
+    }
+    std::string_view rest = trim_view(line.substr(std::min(start, n)));
+    if (!rest.empty()) {
+        items.push_back({op, rest});
+    } else if (op != ListOp::Seq) {
+        std::cerr << "Error de sintaxis: falta el comando tras '" << (op == ListOp::And ? "&&" : "||") << "'\n";
+        return false;
+    }
+    return true;
+}
+
+// Tokenizador de una sola pasada. Reglas (subconjunto de POSIX sh):
+//   '...'  literal, sin escapes
+//   "..."  literal salvo \" \\ \$ y $(...) (sustituido sin dividir)
+//   \x     x literal fuera de comillas
+//   $(cmd) salida de cmd; fuera de comillas se divide en palabras por espacios, tabs y '\n'
+//   $?     estado de salida del último comando (también entre comillas dobles)
+// Las comillas pueden pegarse a texto ("a b"c es la palabra 'a bc'); "" produce una palabra vacía.
+// Con expand_globs, una palabra con *, ? o [ fuera de comillas se sustituye por los archivos que coinciden
+// (el texto que viene de $(...) no se expande).
+bool tokenize_into(std::string_view line, TokenArena &arena, bool expand_globs) {
+    arena.clear();
+    arena.buf.reserve(line.size() * 2 + 1); // Cota sin comodines ni $(...): cada byte más un '\0' por palabra
+    size_t i = 0, n = line.size();
+    size_t word_start = 0;
+    bool wild = false, keep = false; // keep: la palabra existe aunque quede vacía ("" o texto)
+    bool lit = false;                // Alguna parte de la palabra llevó comillas o '\'
+    auto begin_word = [&] {
+        word_start = arena.buf.size();
+        wild = keep = lit = false;
+        arena.starts.push_back(word_start);
+        arena.quoted_meta.clear();
+    };
+    auto end_word = [&] {
+        if (!keep && arena.buf.size() == word_start) { arena.starts.pop_back(); return; } // $(...) vacío: sin palabra
+        if (wild) expand_word(arena, word_start);
+        arena.buf.push_back('\0');
+        // Los nombres que produce un comodín son literales (un archivo llamado '>' no redirige)
+        arena.literal.resize(arena.starts.size(), lit || wild);
+    };
+    std::string_view output;
+    while (i < n) {
+        while (i < n && is_space(line[i])) ++i; // Salta separadores
+        if (i >= n) break;
+        begin_word();
+        while (i < n && !is_space(line[i])) {
+            char c = line[i];
+            if (c == '\'') {
+                size_t e = line.find('\'', i+1);
+                if (e == std::string_view::npos) { std::cerr << "Error: comilla simple sin cerrar\n"; arena.clear(); return false; }
+                size_t from = arena.buf.size();
+                arena.buf.append(line.data()+i+1, e-i-1);
+                mark_quoted(arena, from);
+                keep = lit = true;
+                i = e + 1;
+            } else if (c == '"') {
+                size_t from = arena.buf.size();
+                ++i;
+                while (i < n && line[i] != '"') {
+                    if (line[i] == '$' && i+1 < n && line[i+1] == '(') {
+                        if (!substitute_at(line, i, output)) { arena.clear(); return false; }
+                        arena.buf.append(output.data(), output.size());
+                        continue;
+                    }
+                    if (line[i] == '$' && i+1 < n && line[i+1] == '?') {
+                        arena.buf += std::to_string(last_status);
+                        i += 2;
+                        continue;
+                    }
+                    if (line[i] == '\\' && i+1 < n && (line[i+1]=='"' || line[i+1]=='\\' || line[i+1]=='$')) ++i;
+                    arena.buf.push_back(line[i++]);
+                }
+                if (i >= n) { std::cerr << "Error: comilla doble sin cerrar\n"; arena.clear(); return false; }
+                mark_quoted(arena, from);
+                keep = lit = true;
+                ++i;
+            } else if (c == '\\') {
+                if (i+1 < n) ++i; // Un '\' final queda literal
+                if (is_glob_meta(line[i])) arena.quoted_meta.push_back(arena.buf.size());
+                arena.buf.push_back(line[i++]);
+                keep = lit = true;
+            } else if (c == '$' && i+1 < n && line[i+1] == '?') {
+                arena.buf += std::to_string(last_status);
+                keep = true;
+                i += 2;
+            } else if (c == '$' && i+1 < n && line[i+1] == '(') {
+                if (!substitute_at(line, i, output)) { arena.clear(); return false; }
+                // El primer campo se pega a lo anterior; cada tramo de separadores cierra la palabra
+                size_t k = 0;
+                while (k < output.size()) {
+                    if (is_space(output[k])) {
+                        while (k < output.size() && is_space(output[k])) ++k;
+                        if (keep) { end_word(); begin_word(); }
+                        continue;
+                    }
+                    size_t j = k;
+                    while (j < output.size() && !is_space(output[j])) ++j;
+                    size_t from = arena.buf.size();
+                    arena.buf.append(output.data()+k, j-k);
+                    mark_quoted(arena, from);
+                    keep = lit = true; // La salida de un comando nunca es un operador (ni un '>' de una lista)
+                    k = j;
+                }
+            } else {
+                // Tramo sin caracteres especiales: se copia de una vez ('$' suelto es literal)
+                size_t j = i + (c == '$' ? 1 : 0);
+                while (j < n && !is_space(line[j]) && line[j]!='\'' && line[j]!='"' && line[j]!='\\' && line[j]!='$') ++j;
+                arena.buf.append(line.data()+i, j-i);
+                if (expand_globs && !wild) wild = has_wildcards(line.substr(i, j-i));
+                keep = true;
+                i = j;
+            }
+        }
+        end_word();
+    }
+    // Las vistas se crean al final: buf ya no cambia de tamaño
+    for (size_t k=0;k<arena.starts.size();++k) {
+        size_t end = (k+1 < arena.starts.size() ? arena.starts[k+1] : arena.buf.size()) - 1;
+        arena.words.emplace_back(arena.buf.data() + arena.starts[k], end - arena.starts[k]);
+        arena.argv.push_back(&arena.buf[arena.starts[k]]);
+    }
+    arena.argv.push_back(nullptr);
+    return true;
+}
+
+// Divide una cadena de entrada en tokens (palabras); copia para quien necesita std::string
+std::vector<std::string> tokenize(const std::string &line, bool expand_globs, std::vector<bool> *literal) {
+    thread_local TokenArena arena; // Se reutiliza: sin reservas nuevas en cada línea
+    if (literal) literal->clear();
+    if (!tokenize_into(line, arena, expand_globs)) return {};
+    if (literal) *literal = arena.literal;
+    return std::vector<std::string>(arena.words.begin(), arena.words.end());
+}
+
+bool is_operator_word(std::string_view w) {
+    return w == "|" || w == "<" || w == ">" || w == ">>";
+}
+
+// Devuelve la siguiente línea (sin '\n'); rellena el buffer con read() solo cuando se agota
+bool LineReader::next(std::string &line) {
+    line.clear();
+    while (true) {
+        char *b = buf.data() + start;
+        char *nl = static_cast<char*>(memchr(b, '\n', end - start));
+        if (nl) {
+            line.append(b, nl - b);
+            start = (nl - buf.data()) + 1;
+            return true;
+        }
+        line.append(b, end - start); // Línea partida entre dos lecturas
+        start = end = 0;
+        if (eof) return !line.empty();
+        ssize_t n = read(fd, buf.data(), buf.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) { eof = true; continue; }
+        end = static_cast<size_t>(n);
+    }
 }
@@ -0,0 +1,121 @@
+#include "pathcache.hpp"
+#include "executor.hpp"
+#include <iostream>
+#include <iomanip>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdlib>      // getenv
+#include <sys/stat.h>   // stat (mtime de directorios)
+
+struct PathEntry {
+    std::string path;   // Ruta completa resuelta
+    size_t dir_index;   // Posición en PATH del directorio donde se encontró
+    unsigned long hits; // Veces que se ha usado la entrada
+};
+
+static std::mutex cache_mutex; // Los hilos de parallel también resuelven comandos
+static std::unordered_map<std::string, PathEntry> table;
+static std::string cached_path_env;         // PATH con el que se construyó la tabla
+static bool cache_initialized = false;
+static std::vector<std::string> path_dirs;  // PATH dividido por ':'
+static std::vector<struct timespec> dir_mtimes;
+static std::chrono::steady_clock::time_point last_check;
+// Intervalo mínimo entre comprobaciones de mtime: los comandos repetidos en un script no hacen syscalls
+static const std::chrono::milliseconds recheck_interval(1000);
+
+static struct timespec dir_mtime(const std::string &dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0) return {0, 0};
+    return st.st_mtim;
+}
+
+// Reconstruye la lista de directorios si PATH cambió (requiere cache_mutex)
+static void sync_path_env() {
+    const char *env = getenv("PATH");
+    std::string path_env = env ? env : "/bin:/usr/bin";
+    if (cache_initialized && path_env == cached_path_env) return;
+    cache_initialized = true;
+    cached_path_env = path_env;
+    table.clear();
+    path_dirs.clear();
+    dir_mtimes.clear();
+    size_t pos = 0;
+    while (true) {
+        size_t p = path_env.find(':', pos);
+        std::string dir = path_env.substr(pos, p == std::string::npos ? std::string::npos : p - pos);
+        path_dirs.push_back(dir.empty() ? "." : dir); // Un elemento vacío significa el directorio actual
+        dir_mtimes.push_back(dir_mtime(path_dirs.back()));
+        if (p == std::string::npos) break;
+        pos = p + 1;
+    }
+    last_check = std::chrono::steady_clock::now();
+}
+
+// Invalida las entradas afectadas si el mtime de algún directorio cambió (requiere cache_mutex).
+// Un archivo nuevo en el directorio i puede ocultar comandos de directorios posteriores,
+// por eso se descartan todas las entradas con dir_index >= i.
+static void revalidate_dirs() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_check < recheck_interval) return;
+    last_check = now;
+    for (size_t i=0;i<path_dirs.size();++i) {
+        struct timespec m = dir_mtime(path_dirs[i]);
+        if (m.tv_sec == dir_mtimes[i].tv_sec && m.tv_nsec == dir_mtimes[i].tv_nsec) continue;
+        dir_mtimes[i] = m;
+        for (auto it = table.begin(); it != table.end(); ) {
+            if (it->second.dir_index >= i) it = table.erase(it);
+            else ++it;
+        }
+    }
+}
+
+// Busca el comando en PATH con la tabla; solo los fallos recorren los directorios
+std::string path_cache_lookup(const std::string &cmd) {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+    sync_path_env();
+    revalidate_dirs();
+    auto it = table.find(cmd);
+    if (it != table.end()) {
+        ++it->second.hits;
+        return it->second.path;
+    }
+    for (size_t i=0;i<path_dirs.size();++i) {
+        std::string candidate = path_dirs[i] + "/" + cmd;
+        if (file_exists_and_executable(candidate)) {
+            table[cmd] = PathEntry{candidate, i, 1};
+            return candidate;
+        }
+    }
+    return "";
+}
+
+// Descarta una entrada (p. ej. el ejecutable fue borrado)
+void path_cache_forget(const std::string &cmd) {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+    table.erase(cmd);
+}
+
+void path_cache_clear() {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+    table.clear();
+}
+
+// Precarga un comando en la tabla sin contar un uso
+bool path_cache_warm(const std::string &cmd) {
+    if (path_cache_lookup(cmd).empty()) return false;
+    std::lock_guard<std::mutex> lk(cache_mutex);
+    auto it = table.find(cmd);
+    if (it != table.end() && it->second.hits > 0) --it->second.hits;
+    return true;
+}
+
+// Lista la tabla en el formato de 'hash' de bash
+void path_cache_print() {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+    if (table.empty()) { std::cout << "hash: tabla vacía\n"; return; }
+    std::cout << "hits    command\n";
+    for (auto &p: table)
+        std::cout << std::setw(4) << p.second.hits << "    " << p.second.path << "\n";
+}
@@ -0,0 +1,214 @@
+#include "placement.hpp"
+#include "parallel.hpp"     // online_cpu_count
+#include <iostream>
+#include <sstream>
+#include <cstdlib>          // strtol
+#include <cerrno>
+#include <unistd.h>         // syscall
+#include <sys/syscall.h>    // SYS_ioprio_get, SYS_ioprio_set
+#include <sys/resource.h>   // setpriority, getpriority
+
+// ioprio (linux/ioprio.h no siempre está instalado)
+static const int ioprio_who_process = 1;
+static const int ioprio_class_shift = 13;
+static const char *ioprio_names[] = { "ninguna", "rt", "be", "idle" };
+
+// Resumen de la última ejecución con colocación, para cpuinfo
+static std::string last_report;
+
+bool parse_cpu_list(const std::string &text, std::vector<int> &cpus) {
+    cpus.clear();
+    std::stringstream ss(text);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        char *end = nullptr;
+        long lo = strtol(part.c_str(), &end, 10), hi = lo;
+        if (end == part.c_str()) return false;
+        if (*end == '-') {
+            const char *p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (end == p) return false;
+        }
+        if (*end != '\0' || lo < 0 || hi < lo || hi >= CPU_SETSIZE) return false;
+        for (long c=lo;c<=hi;++c) cpus.push_back(static_cast<int>(c));
+    }
+    return !cpus.empty();
+}
+
+std::string format_cpu_list(const std::vector<int> &cpus) {
+    std::string out;
+    for (size_t i=0;i<cpus.size();) {
+        size_t j = i;
+        while (j+1 < cpus.size() && cpus[j+1] == cpus[j] + 1) ++j; // Tramo consecutivo
+        if (!out.empty()) out += ",";
+        out += std::to_string(cpus[i]);
+        if (j > i) out += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out.empty() ? "-" : out;
+}
+
+static std::vector<int> mask_cpus(const cpu_set_t &mask) {
+    std::vector<int> cpus;
+    for (int c=0;c<CPU_SETSIZE;++c) if (CPU_ISSET(c, &mask)) cpus.push_back(c);
+    return cpus;
+}
+
+std::vector<int> affinity_cpus() {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) return {};
+    return mask_cpus(mask);
+}
+
+static bool parse_ionice(const std::string &text, int &cls, int &level) {
+    std::string name = text.substr(0, text.find(':'));
+    if (name == "rt" || name == "1") cls = 1;
+    else if (name == "be" || name == "2") cls = 2;
+    else if (name == "idle" || name == "3") cls = 3;
+    else return false;
+    level = 4;
+    if (text.size() > name.size()) {
+        char *end = nullptr;
+        level = static_cast<int>(strtol(text.c_str() + name.size() + 1, &end, 10));
+        if (*end != '\0' || level < 0 || level > 7) return false;
+    }
+    if (cls == 3) level = 0; // idle no tiene niveles
+    return true;
+}
+
+int placement_option(const std::vector<std::string> &words, size_t i, Placement &p) {
+    const std::string &opt = words[i];
+    if (opt == "--pin") { p.pin = true; return 1; }
+    if (opt == "--reserve") { p.reserve = true; return 1; }
+    if (opt != "--cpus" && opt != "--nice" && opt != "--ionice") return 0;
+    if (i + 1 >= words.size()) { std::cerr << opt << ": falta el argumento\n"; return -1; }
+    const std::string &arg = words[i+1];
+    if (opt == "--cpus") {
+        if (!parse_cpu_list(arg, p.cpus)) { std::cerr << "--cpus: lista inválida (ej. 0-3,8)\n"; return -1; }
+    } else if (opt == "--nice") {
+        char *end = nullptr;
+        long n = strtol(arg.c_str(), &end, 10);
+        if (*end != '\0' || n < -20 || n > 19) { std::cerr << "--nice: valor entre -20 y 19\n"; return -1; }
+        p.set_nice = true;
+        p.nice = static_cast<int>(n);
+    } else if (!parse_ionice(arg, p.ioprio_class, p.ioprio_level)) {
+        std::cerr << "--ionice: idle, be[:0-7] o rt[:0-7]\n";
+        return -1;
+    }
+    return 2;
+}
+
+static void set_mask(cpu_set_t &mask, const std::vector<int> &cpus) {
+    CPU_ZERO(&mask);
+    for (int c: cpus) CPU_SET(c, &mask);
+}
+
+bool placement_begin(const Placement &p, PlacementRun &run) {
+    run = PlacementRun();
+    if (!p.active()) return false;
+    run.opts = p;
+    CPU_ZERO(&run.original_mask);
+    if (sched_getaffinity(0, sizeof(run.original_mask), &run.original_mask) != 0) { perror("sched_getaffinity"); return false; }
+    run.shell_mask = run.original_mask;
+    std::vector<int> allowed = mask_cpus(run.original_mask);
+
+    // Los CPUs pedidos se limitan a los que la shell tiene permitidos
+    if (!p.cpus.empty()) {
+        for (int c: p.cpus) if (CPU_ISSET(c, &run.original_mask)) run.child_cpus.push_back(c);
+        if (run.child_cpus.empty()) { std::cerr << "parallel: ningún CPU de --cpus está disponible\n"; return false; }
+    } else {
+        run.child_cpus = allowed;
+    }
+    if (p.reserve) {
+        // Se reserva el CPU en el que corre la shell (si no está en la lista de los hijos, el primero permitido)
+        int cur = sched_getcpu();
+        bool in_children = false;
+        for (int c: run.child_cpus) if (c == cur) in_children = true;
+        run.reserved_cpu = (cur >= 0 && CPU_ISSET(cur, &run.original_mask)) ? cur : allowed.front();
+        if (in_children || p.cpus.empty()) {
+            std::vector<int> rest;
+            for (int c: run.child_cpus) if (c != run.reserved_cpu) rest.push_back(c);
+            if (rest.empty()) {
+                std::cerr << "parallel: --reserve necesita al menos 2 CPUs; se ignora\n";
+                run.reserved_cpu = -1;
+            } else {
+                run.child_cpus.swap(rest);
+            }
+        }
+        if (run.reserved_cpu >= 0) {
+            set_mask(run.shell_mask, {run.reserved_cpu});
+            if (sched_setaffinity(0, sizeof(run.shell_mask), &run.shell_mask) != 0) perror("sched_setaffinity");
+        }
+    }
+    run.load.assign(run.child_cpus.size(), 0);
+    run.launched.assign(run.child_cpus.size(), 0);
+    run.active = true;
+    return true;
+}
+
+int placement_acquire(PlacementRun &run) {
+    if (!run.active) return -1;
+    cpu_set_t mask;
+    int slot = -1;
+    if (run.opts.pin) {
+        slot = 0; // CPU con menos hijos vivos; empate, el primero
+        for (size_t i=1;i<run.load.size();++i) if (run.load[i] < run.load[slot]) slot = static_cast<int>(i);
+        ++run.load[slot];
+        ++run.launched[slot];
+        set_mask(mask, {run.child_cpus[slot]});
+    } else {
+        set_mask(mask, run.child_cpus);
+    }
+    // posix_spawn no tiene atributo de afinidad, pero el hijo hereda la del hilo: se cambia durante el spawn
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) perror("sched_setaffinity");
+    return slot;
+}
+
+void placement_spawned(PlacementRun &run, pid_t pid) {
+    if (!run.active) return;
+    sched_setaffinity(0, sizeof(run.shell_mask), &run.shell_mask);
+    if (pid < 0) return;
+    // nice e ionice se aplican al hijo ya creado: la shell no podría recuperar su prioridad sin privilegios
+    if (run.opts.set_nice && setpriority(PRIO_PROCESS, pid, run.opts.nice) != 0) perror("setpriority");
+    if (run.opts.ioprio_class >= 0) {
+        int prio = (run.opts.ioprio_class << ioprio_class_shift) | run.opts.ioprio_level;
+        if (syscall(SYS_ioprio_set, ioprio_who_process, pid, prio) != 0) perror("ioprio_set");
+    }
+}
+
+void placement_release(PlacementRun &run, int slot) {
+    if (run.active && slot >= 0 && run.load[slot] > 0) --run.load[slot];
+}
+
+void placement_end(PlacementRun &run) {
+    if (!run.active) return;
+    sched_setaffinity(0, sizeof(run.original_mask), &run.original_mask);
+    std::ostringstream out;
+    out << "Último parallel/pmap: CPUs de los hijos " << format_cpu_list(run.child_cpus);
+    if (run.reserved_cpu >= 0) out << ", CPU reservado para la shell " << run.reserved_cpu;
+    if (run.opts.set_nice) out << ", nice " << run.opts.nice;
+    if (run.opts.ioprio_class >= 0) out << ", ionice " << ioprio_names[run.opts.ioprio_class] << ":" << run.opts.ioprio_level;
+    out << "\n";
+    if (run.opts.pin) {
+        out << "  Hijos por CPU (--pin):";
+        for (size_t i=0;i<run.child_cpus.size();++i) out << " " << run.child_cpus[i] << ":" << run.launched[i];
+        out << "\n";
+    }
+    last_report = out.str();
+    run.active = false;
+}
+
+void placement_print() {
+    std::cout << "CPUs en línea:     " << online_cpu_count() << "\n";
+    std::cout << "Afinidad shell:    " << format_cpu_list(affinity_cpus()) << " (ahora en CPU " << sched_getcpu() << ")\n";
+    errno = 0;
+    int prio = getpriority(PRIO_PROCESS, 0);
+    if (errno == 0) std::cout << "Nice shell:        " << prio << "\n";
+    long io = syscall(SYS_ioprio_get, ioprio_who_process, 0);
+    if (io >= 0) {
+        int cls = static_cast<int>(io >> ioprio_class_shift);
+        std::cout << "Ionice shell:      " << (cls >= 0 && cls <= 3 ? ioprio_names[cls] : "?") << ":" << (io & 7) << "\n";
+    }
+    if (!last_report.empty()) std::cout << last_report;
+}
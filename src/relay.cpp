@@ -0,0 +1,145 @@
+#include "relay.hpp"
+#include <iostream>
+#include <thread>
+#include <climits>      // INT_MAX
+#include <csignal>
+#include <fcntl.h>      // tee, splice, F_SETPIPE_SZ
+#include <unistd.h>
+#include <pthread.h>    // pthread_sigmask
+#include <sys/stat.h>   // fstat
+#include <errno.h>
+
+static std::vector<std::thread> pending_relays; // Creados durante el comando en curso (solo el hilo principal)
+static const int relay_pipe_size = 1 << 20;
+
+// Un destino: sus datos pasan por un pipe intermedio (tee) salvo el último, que recibe splice desde el origen
+struct RelaySink {
+    int fd;
+    int mid[2] = {-1, -1};
+    bool alive = true;
+    bool copy = false; // splice no admitido por el destino (una terminal, un archivo con O_APPEND): read/write
+    bool is_pipe = false;
+};
+
+// Mueve exactamente n bytes del pipe from al destino; si el destino muere, el resto se descarta.
+// Devuelve false si el destino era un pipe sin lector: como tee(1), el reparto termina ahí.
+static bool drain(int from, RelaySink &sink, size_t n, int devnull) {
+    bool reader_gone = false;
+    char buf[1 << 16];
+    while (n > 0) {
+        int to = sink.alive ? sink.fd : devnull;
+        ssize_t m;
+        if (sink.alive && sink.copy) {
+            m = read(from, buf, n < sizeof(buf) ? n : sizeof(buf));
+            if (m > 0 && write(to, buf, m) != m) { sink.alive = false; continue; } // Los bytes leídos se pierden con el destino
+        } else {
+            m = splice(from, nullptr, to, nullptr, n, SPLICE_F_MOVE);
+        }
+        if (m > 0) { n -= static_cast<size_t>(m); continue; }
+        if (m < 0 && errno == EINTR) continue;
+        if (m < 0 && errno == EINVAL && sink.alive && !sink.copy) { sink.copy = true; continue; }
+        if (sink.alive) { // EPIPE u otro error: se descarta lo que quede
+            reader_gone = reader_gone || (sink.is_pipe && errno == EPIPE);
+            sink.alive = false;
+            continue;
+        }
+        break; // Ni /dev/null acepta: no debería ocurrir
+    }
+    return !reader_gone;
+}
+
+static void relay_loop(int src, std::vector<RelaySink> sinks) {
+    // SIGPIPE (lector cerrado) llega como EPIPE a este hilo; las demás señales las atiende el principal
+    sigset_t set;
+    sigemptyset(&set); sigaddset(&set, SIGPIPE); sigaddset(&set, SIGINT); sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    size_t last = sinks.size() - 1;
+    while (true) {
+        bool any = false;
+        for (auto &s: sinks) any = any || s.alive;
+        if (!any) break; // Nadie lee: al cerrar el origen el comando recibe SIGPIPE
+        // El primer tee espera datos; los siguientes copian los mismos n bytes (los intermedios están vacíos
+        // y tienen al menos la capacidad del origen, así que el tee es completo)
+        ssize_t n = -1;
+        bool failed = false;
+        for (size_t i=0;i<last && !failed;++i) {
+            ssize_t m;
+            do m = tee(src, sinks[i].mid[1], n < 0 ? INT_MAX : n, 0); while (m < 0 && errno == EINTR);
+            if (m < 0) { perror("relay: tee"); failed = true; }
+            else if (n < 0) n = m;
+            else if (m != n) { std::cerr << "relay: tee parcial\n"; failed = true; }
+        }
+        if (failed) break;
+        if (n == 0) break; // EOF: el comando cerró su salida
+        if (n < 0) { // Un solo destino (no debería ocurrir): splice directo
+            do n = splice(src, nullptr, sinks[last].alive ? sinks[last].fd : devnull, nullptr, relay_pipe_size, SPLICE_F_MOVE);
+            while (n < 0 && errno == EINTR);
+            if (n <= 0) break;
+            continue;
+        }
+        bool keep_going = true;
+        for (size_t i=0;i<last;++i) keep_going = drain(sinks[i].mid[0], sinks[i], static_cast<size_t>(n), devnull) && keep_going;
+        keep_going = drain(src, sinks[last], static_cast<size_t>(n), devnull) && keep_going; // Consume los bytes del origen
+        if (!keep_going) break; // Al cerrar el origen, el comando recibe SIGPIPE
+    }
+    close(src);
+    for (auto &s: sinks) {
+        close(s.fd);
+        if (s.mid[0] >= 0) { close(s.mid[0]); close(s.mid[1]); }
+    }
+    if (devnull >= 0) close(devnull);
+}
+
+int relay_start(const std::vector<int> &sinks) {
+    std::vector<RelaySink> list;
+    for (int fd: sinks) {
+        RelaySink s{fd};
+        struct stat st;
+        s.is_pipe = fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+        int fl = fcntl(fd, F_GETFL);
+        s.copy = fl >= 0 && (fl & O_APPEND); // '>>': splice(2) rechaza O_APPEND
+        list.push_back(s);
+    }
+    int src[2];
+    bool ok = !list.empty() && pipe2(src, O_CLOEXEC) == 0;
+    int src_size = relay_pipe_size;
+    for (size_t i=0; ok && i+1<list.size(); ++i) {
+        ok = pipe2(list[i].mid, O_CLOEXEC) == 0;
+        if (!ok) break;
+        fcntl(list[i].mid[1], F_SETPIPE_SZ, relay_pipe_size);
+        int got = fcntl(list[i].mid[1], F_GETPIPE_SZ);
+        if (got > 0 && got < src_size) src_size = got;
+    }
+    if (!ok) {
+        perror("relay: pipe");
+        for (auto &s: list) {
+            close(s.fd);
+            if (s.mid[0] >= 0) { close(s.mid[0]); close(s.mid[1]); }
+        }
+        return -1;
+    }
+    // El origen nunca es más grande que los intermedios: así cada tee copia todo lo que hay en él
+    if (fcntl(src[1], F_SETPIPE_SZ, src_size) < 0 || fcntl(src[1], F_GETPIPE_SZ) > src_size)
+        fcntl(src[1], F_SETPIPE_SZ, 4096);
+    pending_relays.emplace_back(relay_loop, src[0], std::move(list));
+    return src[1];
+}
+
+void relay_join_pending() {
+    for (auto &t: pending_relays) t.join();
+    pending_relays.clear();
+}
+
+void relay_detach_pending() {
+    for (auto &t: pending_relays) t.detach();
+    pending_relays.clear();
+}
+
+void relay_forget_inherited() {
+    if (pending_relays.empty()) return;
+    // Esos hilos no existen en el hijo: ni join ni detach, y un std::thread que se destruye sin
+    // ellos llama a terminate. Se sueltan sin destruir (el hijo termina con _exit o exec).
+    new std::vector<std::thread>(std::move(pending_relays));
+    pending_relays.clear();
+}
@@ -1,9 +1,37 @@
 #include "signals.hpp"
-#include <sys/wait.h>   // waitpid
-#include <iostream>     // std::cout
-#include <unistd.h>     // write
+#include "trace.hpp"
+#include "relay.hpp"
+#include <sys/wait.h>       // waitpid
+#include <sys/epoll.h>      // epoll_create1, epoll_wait
+#include <sys/syscall.h>    // SYS_pidfd_open
+#include <iostream>         // std::cout
+#include <unistd.h>         // write
+#include <pthread.h>        // Hilo recolector
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <errno.h>
 
 volatile sig_atomic_t child_terminated = 0; // Bandera para indicar que hay hijos terminados
+volatile sig_atomic_t interrupt_received = 0; // Bandera para quien lanza varios comandos (parallel, pmap)
+bool forked_child = false;
+
+// Un trabajo en segundo plano: un comando o todas las etapas de una tubería
+struct Job {
+    std::string cmdline;
+    std::vector<pid_t> pids;
+    size_t remaining = 0;   // Procesos que siguen vivos
+    int status = 0;         // Estado de la última etapa
+};
+
+static std::mutex jobs_mutex; // Protege la tabla frente al hilo recolector
+static std::condition_variable jobs_cv;
+static std::map<int, Job> job_table;
+static std::map<int, std::pair<int, pid_t>> pidfd_owner; // pidfd -> (id del trabajo, pid)
+static std::vector<std::pair<int, pid_t>> polled;        // Sin pidfd (kernel < 5.3): se sondean con WNOHANG
+static int next_job_id = 1;
+static int reaper_epfd = -1;
 
 // Manejador de la señal SIGCHLD
 void sigchld_handler(int) {
@@ -12,21 +40,202 @@ void sigchld_handler(int) {
 
 // Manejador de la señal SIGINT (Ctrl+C)
 void sigint_handler(int) {
+    interrupt_received = 1;
     // Usa write() que es seguro para manejar señales (async-safe)
     write(STDOUT_FILENO, "\n", 1); 
 }
 
-// Recolecta procesos hijos terminados (zombies) de forma no bloqueante
-void reap_children_nonblocking() {
-    int status;
-    pid_t pid;
-    // Llama a waitpid con WNOHANG para no bloquear; recolecta cualquier hijo (-1)
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        if (WIFEXITED(status))
-            std::cout << "[reaped pid " << pid << " exit " << WEXITSTATUS(status) << "]\n"; // Salida normal
-        else if (WIFSIGNALED(status))
-            std::cout << "[reaped pid " << pid << " signal " << WTERMSIG(status) << "]\n"; // Terminado por señal
-        // Nota: std::cout no es async-safe, pero esta función se llama desde main.
+static int decode_status(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+// Registra la terminación de un proceso del trabajo id (requiere jobs_mutex)
+static void record_exit(int id, pid_t pid, int status) {
+    auto it = job_table.find(id);
+    if (it == job_table.end()) return;
+    if (it->second.remaining > 0) --it->second.remaining;
+    if (pid == it->second.pids.back()) it->second.status = decode_status(status);
+    child_terminated = 1; // La notificación se imprime antes del siguiente prompt
+    jobs_cv.notify_all();
+}
+
+// Hilo recolector: recoge cada proceso en cuanto su pidfd indica que terminó
+static void* reaper_thread(void*) {
+    trace_thread_name("recolector");
+    // Las señales las atiende el hilo principal
+    sigset_t set;
+    sigemptyset(&set); sigaddset(&set, SIGINT); sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    struct epoll_event events[32];
+    while (true) {
+        int n = epoll_wait(reaper_epfd, events, 32, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            return nullptr;
+        }
+        for (int i=0;i<n;++i) {
+            int pfd = events[i].data.fd;
+            std::pair<int, pid_t> owner;
+            {
+                std::lock_guard<std::mutex> lk(jobs_mutex);
+                auto it = pidfd_owner.find(pfd);
+                if (it == pidfd_owner.end()) continue;
+                owner = it->second;
+                pidfd_owner.erase(it);
+            }
+            int status = 0;
+            while (waitpid(owner.second, &status, 0) < 0 && errno == EINTR) {} // Ya terminó: no bloquea
+            trace_child_end(owner.second);
+            epoll_ctl(reaper_epfd, EPOLL_CTL_DEL, pfd, nullptr);
+            close(pfd);
+            std::lock_guard<std::mutex> lk(jobs_mutex);
+            record_exit(owner.first, owner.second, status);
+        }
+    }
+}
+
+static void jobs_lock() { jobs_mutex.lock(); }
+static void jobs_unlock() { jobs_mutex.unlock(); }
+
+// Crea el epoll y el hilo recolector la primera vez que hay un trabajo
+static void start_reaper() {
+    // Desde ahora otro hilo puede tener jobs_mutex: un fork lo toma antes y lo suelta en ambos lados
+    pthread_atfork(jobs_lock, jobs_unlock, jobs_unlock);
+    reaper_epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (reaper_epfd < 0) { perror("epoll_create1"); return; }
+    pthread_t th;
+    if (pthread_create(&th, nullptr, &reaper_thread, nullptr) != 0) {
+        perror("pthread_create");
+        close(reaper_epfd);
+        reaper_epfd = -1;
+        return;
+    }
+    pthread_detach(th);
+}
+
+pid_t fork_child() {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        forked_child = true;
+        relay_forget_inherited(); // Los repartidores pendientes son hilos del padre
+        struct sigaction sa_default; sa_default.sa_handler = SIG_DFL;
+        sigemptyset(&sa_default.sa_mask); sa_default.sa_flags = 0;
+        sigaction(SIGINT, &sa_default, nullptr);
+    }
+    return pid;
+}
+
+int job_add(const std::vector<pid_t> &pids, const std::string &cmdline) {
+    static std::once_flag reaper_once;
+    std::call_once(reaper_once, start_reaper);
+    std::lock_guard<std::mutex> lk(jobs_mutex);
+    int id = next_job_id++;
+    Job &job = job_table[id];
+    job.cmdline = cmdline;
+    job.pids = pids;
+    job.remaining = pids.size();
+    for (pid_t pid: pids) {
+        // Un proceso que ya terminó sigue siendo válido para pidfd_open hasta que se recoge
+        int pfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = pfd;
+        if (pfd >= 0 && reaper_epfd >= 0 && epoll_ctl(reaper_epfd, EPOLL_CTL_ADD, pfd, &ev) == 0) {
+            pidfd_owner[pfd] = {id, pid};
+        } else {
+            if (pfd >= 0) close(pfd);
+            polled.push_back({id, pid});
+        }
+    }
+    return id;
+}
+
+// Sondea sin bloquear los procesos sin pidfd (requiere jobs_mutex)
+static void poll_unwatched() {
+    for (auto it = polled.begin(); it != polled.end(); ) {
+        int status;
+        pid_t r = waitpid(it->second, &status, WNOHANG);
+        if (r == it->second) {
+            trace_child_end(it->second);
+            record_exit(it->first, it->second, status);
+            it = polled.erase(it);
+        } else if (r < 0 && errno != EINTR) {
+            it = polled.erase(it); // Ya no es hijo nuestro
+        } else {
+            ++it;
+        }
     }
+}
+
+// Notifica (antes del prompt) los trabajos que terminaron y los quita de la tabla
+void reap_children_nonblocking() {
     child_terminated = 0; // Desactiva la bandera
+    std::lock_guard<std::mutex> lk(jobs_mutex);
+    poll_unwatched();
+    for (auto it = job_table.begin(); it != job_table.end(); ) {
+        if (it->second.remaining == 0) {
+            std::cout << "[" << it->first << "] terminado (salida " << it->second.status << ")  " << it->second.cmdline << "\n";
+            it = job_table.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void jobs_print() {
+    std::lock_guard<std::mutex> lk(jobs_mutex);
+    for (auto &p: job_table) {
+        std::cout << "[" << p.first << "] ";
+        if (p.second.remaining > 0) std::cout << "ejecutando        ";
+        else std::cout << "terminado (salida " << p.second.status << ")  ";
+        std::cout << p.second.cmdline << "  (pids";
+        for (pid_t pid: p.second.pids) std::cout << " " << pid;
+        std::cout << ")\n";
+    }
+}
+
+// El hilo recolector despierta la condición al recoger cada proceso. La espera va en pasos cortos
+// porque una señal no interrumpe la de la condición: entre paso y paso se sondean los hijos sin
+// pidfd y se mira Ctrl+C, que corta 'wait'/'fg' con 130 (el trabajo sigue en la tabla).
+int job_wait(int id) {
+    std::unique_lock<std::mutex> lk(jobs_mutex);
+    if (id >= 0 && job_table.find(id) == job_table.end()) {
+        std::cerr << "wait: no existe el trabajo " << id << "\n";
+        return 127;
+    }
+    auto done = [&]{
+        if (id >= 0) return job_table[id].remaining == 0;
+        for (auto &p: job_table) if (p.second.remaining > 0) return false;
+        return true;
+    };
+    interrupt_received = 0;
+    while (true) {
+        poll_unwatched();
+        if (jobs_cv.wait_for(lk, std::chrono::milliseconds(50), done)) break;
+        if (interrupt_received) return 130;
+    }
+    int status = 0;
+    if (id >= 0) {
+        status = job_table[id].status;
+        job_table.erase(id);
+    } else {
+        if (!job_table.empty()) status = job_table.rbegin()->second.status;
+        job_table.clear();
+    }
+    return status;
+}
+
+int job_last_id() {
+    std::lock_guard<std::mutex> lk(jobs_mutex);
+    return job_table.empty() ? 0 : job_table.rbegin()->first;
+}
+
+std::string job_command(int id) {
+    std::lock_guard<std::mutex> lk(jobs_mutex);
+    auto it = job_table.find(id);
+    return it == job_table.end() ? "" : it->second.cmdline;
 }
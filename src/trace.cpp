@@ -0,0 +1,205 @@
+#include "trace.hpp"
+#include <iostream>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <thread>       // this_thread::yield
+#include <vector>
+#include <unordered_map>
+#include <cstdio>       // snprintf
+#include <cstdlib>      // atexit
+#include <cstring>
+#include <ctime>        // clock_gettime
+#include <pthread.h>    // pthread_atfork
+#include <unistd.h>     // getpid, gettid, getcwd
+
+std::atomic<bool> trace_enabled(false);
+
+// Evento completo ("ph":"X"); el nombre se copia para no depender de la vida del argv
+struct TraceEvent {
+    uint64_t ts, dur;
+    pid_t pid, tid;
+    char name[40];
+};
+
+// Buffer circular de un hilo: solo él escribe; al llenarse se pisan los eventos más antiguos.
+// busy marca una escritura en curso: trace_start/trace_stop esperan a que se apague antes de
+// vaciar o leer el buffer.
+struct TraceRing {
+    std::vector<TraceEvent> events;
+    std::atomic<uint64_t> written{0};
+    std::atomic<bool> busy{false};
+    pid_t tid = 0;
+    std::string thread_name;
+};
+
+static const size_t ring_capacity = 1 << 16;
+static std::mutex trace_mutex; // Protege la lista de buffers, los hijos pendientes y el archivo
+static std::vector<std::unique_ptr<TraceRing>> rings;
+static std::unordered_map<pid_t, std::pair<uint64_t, std::string>> live_children; // pid -> (inicio, nombre)
+static std::string output_file;
+static thread_local TraceRing *my_ring = nullptr;
+static thread_local const char *my_thread_name = nullptr;
+
+uint64_t trace_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void trace_thread_name(const char *name) {
+    my_thread_name = name;
+    if (my_ring) my_ring->thread_name = name;
+}
+
+// El buffer se crea la primera vez que el hilo registra algo
+static TraceRing *ring_for_thread() {
+    if (my_ring) return my_ring;
+    auto ring = std::make_unique<TraceRing>();
+    ring->events.resize(ring_capacity);
+    ring->tid = gettid();
+    ring->thread_name = my_thread_name ? my_thread_name : (ring->tid == getpid() ? "mini_shell" : "hilo");
+    std::lock_guard<std::mutex> lk(trace_mutex);
+    my_ring = ring.get();
+    rings.push_back(std::move(ring));
+    return my_ring;
+}
+
+static void push_event(const char *name, uint64_t ts, uint64_t dur, pid_t pid, pid_t tid) {
+    TraceRing *ring = ring_for_thread();
+    // busy antes de volver a mirar trace_enabled (ambos seq_cst): o el escritor ve la traza
+    // desactivada y no toca el buffer, o quiet_writers lo ve ocupado y espera
+    ring->busy.store(true);
+    if (!trace_enabled.load()) { ring->busy.store(false, std::memory_order_release); return; }
+    uint64_t n = ring->written.load(std::memory_order_relaxed);
+    TraceEvent &e = ring->events[n % ring_capacity];
+    e.ts = ts;
+    e.dur = dur;
+    e.pid = pid;
+    e.tid = tid ? tid : ring->tid;
+    snprintf(e.name, sizeof(e.name), "%s", name);
+    ring->written.store(n + 1, std::memory_order_release);
+    ring->busy.store(false, std::memory_order_release);
+}
+
+// Con trace_enabled ya en false, espera a las escrituras en curso (requiere trace_mutex)
+static void quiet_writers() {
+    for (auto &r: rings)
+        while (r->busy.load(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+void trace_complete(const char *name, uint64_t start_ns) {
+    if (!trace_enabled.load(std::memory_order_relaxed)) return;
+    push_event(name, start_ns, trace_now_ns() - start_ns, getpid(), 0);
+}
+
+void trace_child_start(pid_t pid, const char *name, uint64_t start_ns) {
+    if (!trace_enabled.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lk(trace_mutex);
+    live_children[pid] = {start_ns ? start_ns : trace_now_ns(), name};
+}
+
+void trace_child_end(pid_t pid) {
+    if (!trace_enabled.load(std::memory_order_relaxed)) return;
+    std::pair<uint64_t, std::string> child;
+    {
+        std::lock_guard<std::mutex> lk(trace_mutex);
+        auto it = live_children.find(pid);
+        if (it == live_children.end()) return; // Lanzado antes de 'trace on'
+        child = std::move(it->second);
+        live_children.erase(it);
+    }
+    push_event(child.second.c_str(), child.first, trace_now_ns() - child.first, pid, pid);
+}
+
+static void trace_at_exit() {
+    if (trace_enabled) trace_stop(); // 'salir' o fin del script con la traza activa
+}
+
+bool trace_start(const std::string &file) {
+    std::lock_guard<std::mutex> lk(trace_mutex);
+    static bool registered = false;
+    if (!registered) {
+        std::atexit(trace_at_exit);
+        // Un fork (etapa built-in, $(...)) no debe heredar el mutex tomado por el recolector
+        // En el hijo los demás hilos no existen: sus escrituras a medias no van a terminar
+        pthread_atfork([] { trace_mutex.lock(); }, [] { trace_mutex.unlock(); }, [] {
+            for (auto &r: rings) r->busy.store(false, std::memory_order_relaxed);
+            trace_mutex.unlock();
+        });
+        registered = true;
+    }
+    output_file = file;
+    if (!file.empty() && file[0] != '/') { // Relativo al directorio de 'trace on', aunque luego se haga cd
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd))) output_file = std::string(cwd) + "/" + file;
+    }
+    trace_enabled.store(false); // Un 'trace on' repetido: nadie escribe mientras se vacía
+    quiet_writers();
+    for (auto &r: rings) r->written.store(0, std::memory_order_relaxed);
+    live_children.clear();
+    trace_enabled.store(true);
+    return true;
+}
+
+const std::string &trace_file() {
+    return output_file;
+}
+
+static void json_string(std::ostream &out, const char *s) {
+    out << '"';
+    for (; *s; ++s) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') out << '\\' << *s;
+        else if (c < 0x20) { char esc[8]; snprintf(esc, sizeof(esc), "\\u%04x", c); out << esc; }
+        else out << *s;
+    }
+    out << '"';
+}
+
+// Microsegundos con decimales, la unidad de "ts" y "dur"
+static void json_us(std::ostream &out, uint64_t ns) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%llu.%03llu", static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+    out << buf;
+}
+
+bool trace_stop() {
+    trace_enabled.store(false);
+    std::lock_guard<std::mutex> lk(trace_mutex);
+    quiet_writers(); // A partir de aquí los buffers no cambian
+    std::ofstream out(output_file);
+    if (!out) { perror(("trace: " + output_file).c_str()); return false; }
+    pid_t self = getpid();
+    size_t total = 0;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << self << ",\"args\":{\"name\":\"mini_shell\"}}";
+    for (auto &r: rings) {
+        uint64_t n = r->written.load(std::memory_order_acquire);
+        if (n == 0) continue;
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << self << ",\"tid\":" << r->tid << ",\"args\":{\"name\":";
+        json_string(out, r->thread_name.c_str());
+        out << "}}";
+        uint64_t first = n > ring_capacity ? n - ring_capacity : 0;
+        for (uint64_t k=first;k<n;++k) {
+            const TraceEvent &e = r->events[k % ring_capacity];
+            if (e.pid != self) { // Pista propia para cada hijo, con su comando como nombre de proceso
+                out << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << e.pid << ",\"args\":{\"name\":";
+                json_string(out, e.name);
+                out << "}}";
+            }
+            out << ",\n{\"name\":";
+            json_string(out, e.name);
+            out << ",\"cat\":\"" << (e.pid != self ? "child" : "shell") << "\",\"ph\":\"X\",\"ts\":";
+            json_us(out, e.ts);
+            out << ",\"dur\":";
+            json_us(out, e.dur);
+            out << ",\"pid\":" << e.pid << ",\"tid\":" << e.tid << "}";
+            ++total;
+        }
+    }
+    out << "\n]}\n";
+    out.close();
+    std::cerr << "trace: " << total << " eventos en " << output_file << "\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,268 @@
+#include "wildcard.hpp"
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>        // std::sort, std::lower_bound
+#include <cstring>
+#include <cstdint>
+#include <ctime>            // clock_gettime, clock_getres
+#include <fcntl.h>          // open
+#include <unistd.h>         // close, syscall
+#include <dirent.h>         // DT_DIR, DT_LNK, DT_UNKNOWN
+#include <sys/stat.h>       // stat
+#include <sys/syscall.h>    // SYS_getdents64
+
+// Registro de getdents64 (no lo exporta glibc)
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// Entrada de un listado: el nombre vive en el bloque names del listado (sin una std::string por archivo)
+struct DirEntry {
+    uint64_t key;       // Primeros 8 bytes del nombre (big-endian): casi todas las comparaciones del sort se resuelven aquí
+    uint32_t off, len;
+    unsigned char type; // DT_DIR, DT_LNK, DT_UNKNOWN, ...
+};
+
+// Listado ordenado de un directorio, válido mientras coincidan dispositivo, inodo, tamaño y mtime
+struct DirListing {
+    dev_t dev = 0;
+    ino_t ino = 0;
+    off_t size = 0;
+    struct timespec mtime = {0, 0};
+    bool recent = false; // Leído en el mismo tick que su mtime: no basta para confirmarlo
+    std::string names;
+    std::vector<DirEntry> entries;
+    std::string_view name(const DirEntry &e) const { return std::string_view(names.data() + e.off, e.len); }
+};
+
+static std::unordered_map<std::string, DirListing> dir_cache; // Clave: ruta tal como aparece en el patrón
+static const size_t max_cached_dirs = 256;
+static std::mutex glob_mutex; // La caché es compartida (tokenize se usa desde varios hilos)
+
+bool has_wildcards(std::string_view word) {
+    return word.find_first_of("*?[") != std::string_view::npos;
+}
+
+void glob_cache_clear() {
+    std::lock_guard<std::mutex> lock(glob_mutex);
+    dir_cache.clear();
+}
+
+// Lee el directorio con getdents64 en bloques grandes (pocas syscalls con 100k+ entradas)
+static bool read_dir(const std::string &dir, DirListing &listing) {
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    listing.entries.clear();
+    listing.names.clear();
+    static std::vector<char> buf(1 << 20);
+    while (true) {
+        long n = syscall(SYS_getdents64, fd, buf.data(), buf.size());
+        if (n <= 0) break;
+        for (long pos = 0; pos < n; ) {
+            auto *d = reinterpret_cast<linux_dirent64*>(buf.data() + pos);
+            pos += d->d_reclen;
+            if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0) continue;
+            uint32_t len = strlen(d->d_name);
+            uint64_t key = 0;
+            for (uint32_t k=0;k<8;++k) key = (key << 8) | (k < len ? static_cast<unsigned char>(d->d_name[k]) : 0);
+            listing.entries.push_back(DirEntry{key, static_cast<uint32_t>(listing.names.size()), len, d->d_type});
+            listing.names.append(d->d_name, len);
+        }
+    }
+    close(fd);
+    std::sort(listing.entries.begin(), listing.entries.end(),
+              [&](const DirEntry &a, const DirEntry &b) {
+                  if (a.key != b.key) return a.key < b.key;
+                  return listing.name(a) < listing.name(b);
+              });
+    return true;
+}
+
+// Las marcas de tiempo de los archivos avanzan a saltos (un tick del reloj grueso del kernel): dos
+// cambios en el mismo tick dejan igual el mtime. Un listado con un mtime tan reciente se vuelve a
+// leer en la siguiente búsqueda, hasta que el mtime quede atrás.
+static bool modified_recently(const struct timespec &mtime) {
+    static const int64_t tick_ns = [] {
+        struct timespec res;
+        if (clock_getres(CLOCK_REALTIME_COARSE, &res) != 0) return int64_t(10000000); // 10 ms
+        return int64_t(res.tv_sec) * 1000000000 + res.tv_nsec;
+    }();
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t age = int64_t(now.tv_sec - mtime.tv_sec) * 1000000000 + (now.tv_nsec - mtime.tv_nsec);
+    return age < 2 * tick_ns;
+}
+
+// Devuelve el listado en caché; un stat basta para saber si sigue siendo válido
+static const DirListing *get_listing(const std::string &dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return nullptr;
+    auto it = dir_cache.find(dir);
+    if (it != dir_cache.end()) {
+        DirListing &l = it->second;
+        // dev/ino cubren un 'cd' (misma ruta relativa, otro directorio)
+        if (!l.recent && l.dev == st.st_dev && l.ino == st.st_ino && l.size == st.st_size &&
+            l.mtime.tv_sec == st.st_mtim.tv_sec && l.mtime.tv_nsec == st.st_mtim.tv_nsec)
+            return &l;
+    }
+    if (it == dir_cache.end() && dir_cache.size() >= max_cached_dirs) dir_cache.clear(); // Memoria acotada
+    bool recent = modified_recently(st.st_mtim); // Antes de leer: un cambio posterior tendrá otro mtime
+    DirListing &l = dir_cache[dir];
+    if (!read_dir(dir, l)) { dir_cache.erase(dir); return nullptr; }
+    l.dev = st.st_dev;
+    l.ino = st.st_ino;
+    l.size = st.st_size;
+    l.mtime = st.st_mtim;
+    l.recent = recent;
+    return &l;
+}
+
+// Compara un conjunto [...] en p; avanza p tras el ']'. Sin ']' de cierre, '[' es literal.
+static bool match_bracket(std::string_view p, size_t &pi, char c, bool &ok) {
+    size_t i = pi + 1;
+    bool negate = false;
+    if (i < p.size() && (p[i] == '!' || p[i] == '^')) { negate = true; ++i; }
+    size_t start = i;
+    bool found = false;
+    while (i < p.size() && (p[i] != ']' || i == start)) {
+        char lo = p[i];
+        if (lo == '\\' && i+1 < p.size()) lo = p[++i];
+        char hi = lo;
+        if (i+2 < p.size() && p[i+1] == '-' && p[i+2] != ']') {
+            hi = p[i+2];
+            if (hi == '\\' && i+3 < p.size()) { hi = p[i+3]; ++i; }
+            i += 2;
+        }
+        if (c >= lo && c <= hi) found = true;
+        ++i;
+    }
+    if (i >= p.size()) return false; // Sin cierre
+    pi = i + 1;
+    ok = (found != negate);
+    return true;
+}
+
+// Comparación de comodines con retroceso lineal sobre el último '*'
+bool glob_match(std::string_view p, std::string_view s) {
+    size_t pi = 0, si = 0, star_p = std::string_view::npos, star_s = 0;
+    while (si < s.size()) {
+        if (pi < p.size()) {
+            char pc = p[pi];
+            if (pc == '*') { star_p = ++pi; star_s = si; continue; }
+            if (pc == '?') { ++pi; ++si; continue; }
+            if (pc == '[') {
+                bool ok = false;
+                size_t next = pi;
+                if (match_bracket(p, next, s[si], ok)) {
+                    if (ok) { pi = next; ++si; continue; }
+                } else if (s[si] == '[') { ++pi; ++si; continue; }
+            } else {
+                if (pc == '\\' && pi+1 < p.size()) pc = p[pi+1];
+                if (pc == s[si]) { pi += (p[pi] == '\\' && pi+1 < p.size()) ? 2 : 1; ++si; continue; }
+            }
+        }
+        if (star_p == std::string_view::npos) return false;
+        pi = star_p; // El '*' absorbe un carácter más
+        si = ++star_s;
+    }
+    while (pi < p.size() && p[pi] == '*') ++pi;
+    return pi == p.size();
+}
+
+// Parte literal inicial de un componente (sin escapes) para acotar la búsqueda en el listado ordenado
+static std::string literal_prefix(std::string_view comp) {
+    std::string out;
+    for (size_t i=0;i<comp.size();++i) {
+        char c = comp[i];
+        if (c == '*' || c == '?' || c == '[') break;
+        if (c == '\\' && i+1 < comp.size()) c = comp[++i];
+        out += c;
+    }
+    return out;
+}
+
+static std::string unescape(std::string_view comp) {
+    std::string out;
+    for (size_t i=0;i<comp.size();++i) {
+        if (comp[i] == '\\' && i+1 < comp.size()) ++i;
+        out += comp[i];
+    }
+    return out;
+}
+
+static bool entry_is_dir(const std::string &prefix, std::string_view name, unsigned char type) {
+    if (type == DT_DIR) return true;
+    if (type != DT_LNK && type != DT_UNKNOWN) return false;
+    struct stat st; // Enlace simbólico o sistema de archivos sin d_type
+    return stat((prefix + std::string(name)).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Primera entrada del listado ordenado que no es menor que key
+static std::vector<DirEntry>::const_iterator lower_entry(const DirListing &l, std::string_view key) {
+    return std::lower_bound(l.entries.begin(), l.entries.end(), key,
+                            [&](const DirEntry &e, std::string_view k) { return l.name(e) < k; });
+}
+
+// Recorre los componentes del patrón; prefix es la ruta ya resuelta ("" o terminada en '/')
+static void expand_from(const std::string &prefix, const std::vector<std::string> &comps, size_t i, std::vector<std::string> &out) {
+    const std::string &comp = comps[i];
+    bool last = (i + 1 == comps.size());
+    if (last && comp.empty()) { out.push_back(prefix); return; } // Patrón terminado en '/': solo directorios
+    std::string dir = prefix.empty() ? "." : prefix;
+
+    if (!has_wildcards(comp)) {
+        std::string name = unescape(comp);
+        if (!last) { expand_from(prefix + name + "/", comps, i+1, out); return; }
+        const DirListing *l = get_listing(dir);
+        if (!l) return;
+        auto it = lower_entry(*l, name);
+        if (it != l->entries.end() && l->name(*it) == name) out.push_back(prefix + name);
+        return;
+    }
+
+    const DirListing *l = get_listing(dir);
+    if (!l) return;
+    bool dot_ok = (comp[0] == '.'); // Los ocultos solo con un '.' explícito
+    std::string lit = literal_prefix(comp);
+    // Copia de los nombres: la recursión puede invalidar la caché de este directorio
+    std::vector<std::string> hits;
+    for (auto it = lower_entry(*l, lit); it != l->entries.end(); ++it) {
+        std::string_view name = l->name(*it);
+        if (name.compare(0, lit.size(), lit) != 0) break; // Fin del tramo con el prefijo literal
+        if (name[0] == '.' && !dot_ok) continue;
+        if (!glob_match(comp, name)) continue;
+        if (!last && !entry_is_dir(prefix, name, it->type)) continue;
+        hits.emplace_back(name);
+    }
+    for (auto &name: hits) {
+        if (last) out.push_back(prefix + name);
+        else expand_from(prefix + name + "/", comps, i+1, out);
+    }
+}
+
+bool glob_expand(const std::string &pattern, std::vector<std::string> &out) {
+    size_t before = out.size();
+    std::vector<std::string> comps;
+    std::string prefix;
+    size_t pos = 0;
+    if (!pattern.empty() && pattern[0] == '/') { prefix = "/"; pos = 1; }
+    int wild_comps = 0;
+    while (pos <= pattern.size()) {
+        size_t slash = pattern.find('/', pos);
+        if (slash == std::string::npos) slash = pattern.size();
+        std::string comp = pattern.substr(pos, slash - pos);
+        if (!comp.empty() || slash == pattern.size()) comps.push_back(comp); // Ignora '//' intermedios
+        if (has_wildcards(comp)) ++wild_comps;
+        pos = slash + 1;
+    }
+    if (comps.empty()) return false;
+    std::lock_guard<std::mutex> lock(glob_mutex);
+    expand_from(prefix, comps, 0, out);
+    // Con un solo componente con comodines el resultado ya sale ordenado; si no, se ordena la ruta completa como glob(3)
+    if (wild_comps > 1) std::sort(out.begin() + before, out.end());
+    return out.size() > before;
+}